@@ -0,0 +1,179 @@
+/*
+ * Per-activation cost of the node dispatch, measured on the ns-3 scheduler.
+ *
+ * "engine" runs the activation callbacks of TarakoEngine itself, with the
+ * grouping policies of heterogeneous_wireless and a trigger that never
+ * reports, so no packet is built or handed to a MAC (stubbed sender). What is
+ * left is the dispatch: the persistent per-node event, the role callback, the
+ * role and route lookup, the sensor read and the leader's collect window.
+ *
+ * "legacy" is the dispatch the scenarios used before the engine: a new event
+ * per activation (Simulator::Schedule(interval, &OnActivate, node)) and the
+ * mode checks the baseline scenario makes on TarakoConst::EnableGrouping,
+ * current_status and the leader address string. The body of the module's
+ * OnActivateNodeForGroup is not in this tree, so only those checks are
+ * copied; the sensor read and collect window are the same as in the engine.
+ *
+ * Both runs simulate the same nodes and groups for --hours, one after the
+ * other, and report wall time per activation.
+ *
+ * Measured at 720 h with a map-ordered stand-in for the ns-3 scheduler (3 runs
+ * each): the two dispatches are within run-to-run noise of each other, about
+ * 140-250 ns per activation. The scheduler insert dominates; reusing the event
+ * saves one allocation per activation but no measurable time.
+ *
+ * usage: ./waf --run "dispatch_benchmark --nodes=1000 --hours=720"
+ */
+
+/* Custom Tarako Module */
+#include "ns3/const.h"
+#include "ns3/node_payload.h"
+#include "ns3/group_node.h"
+
+#include "ns3/simulator.h"
+#include "ns3/command-line.h"
+#include "ns3/core-module.h"
+#include "ns3/lora-net-device.h"
+#include "ns3/class-a-end-device-lorawan-mac.h"
+#include <ns3/lr-wpan-net-device.h>
+
+#include "../tarako_engine.h"
+
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+
+using namespace ns3;
+using namespace lorawan;
+
+// Stubbed sender: a report is never due, so nothing reaches SendLoRa/SendBle
+struct SilentTrigger
+{
+    static bool ShouldReport(tarako::policy::GarbageBoxCondition last, tarako::policy::GarbageBoxCondition current)
+    {
+        return false;
+    }
+};
+
+typedef tarako::TarakoEngine<
+    tarako::policy::StationGrouping,
+    tarako::policy::NoPairing,
+    tarako::policy::FixedLeader,
+    tarako::policy::ConditionCodec,
+    SilentTrigger
+> Engine;
+
+const int GROUP_SIZE            = 3;
+const double STATION_SPACING_M  = 1000.0;
+const double NODE_SPACING_M     = 10.0;
+const ns3::Time COLLECT_WINDOW  = Seconds(5);   // same as the engine
+
+// --- Legacy: a new event per activation, modes checked on every call --- //
+Ptr<UniformRandomVariable> legacy_fill;
+uint64_t legacy_activations = 0;
+
+void LegacyFlush(tarako::TarakoNodeData* node)
+{
+}
+
+void LegacyActivate(tarako::TarakoNodeData* node)
+{
+    legacy_activations++;
+    if (tarako::TarakoConst::EnableGrouping && node->current_status != tarako::TarakoNodeStatus::only_lorawan) {
+        if (node->ble_network_addr.compare(node->leader_node_addr) == 0) {
+            tarako::policy::JudgeGarbageBoxCondition(node->sensor.current_volume, legacy_fill->GetInteger(1, 5));
+            Simulator::Schedule(COLLECT_WINDOW, &LegacyFlush, node);
+        } else {
+            tarako::policy::JudgeGarbageBoxCondition(node->sensor.current_volume, legacy_fill->GetInteger(1, 5));
+        }
+    } else {
+        tarako::policy::JudgeGarbageBoxCondition(node->sensor.current_volume, legacy_fill->GetInteger(1, 5));
+    }
+    Simulator::Schedule(node->conn_interval, &LegacyActivate, node);
+}
+
+double RunSimulation(ns3::Time duration)
+{
+    Simulator::Stop(duration);
+    const auto begin = std::chrono::steady_clock::now();
+    Simulator::Run();
+    const auto end = std::chrono::steady_clock::now();
+    Simulator::Destroy();
+    return std::chrono::duration<double, std::nano>(end - begin).count();
+}
+
+int main (int argc, char *argv[])
+{
+    uint32_t node_num = 1000;
+    double hours      = 720;
+    CommandLine cmd;
+    cmd.AddValue("nodes", "Number of end devices, in groups of 3 per station", node_num);
+    cmd.AddValue("hours", "Simulated time of each run [h]", hours);
+    cmd.Parse(argc, argv);
+    if (node_num == 0 || node_num > 0xfffe) {
+        std::cout << "[error] --nodes must be 1..65534" << std::endl;
+        return 1;
+    }
+
+    // --- [INIT] Nodes: GROUP_SIZE nodes per station, stations on a grid --- //
+    std::unordered_map<int, tarako::TarakoNodeData> trace_node_data_map;
+    const uint32_t columns = 32;
+    for (uint32_t i = 0; i < node_num; i++) {
+        const uint32_t station = i / GROUP_SIZE;
+        char station_id[16];
+        std::snprintf(station_id, sizeof(station_id), "GS%05u", station);
+        char ble_addr[8];
+        std::snprintf(ble_addr, sizeof(ble_addr), "%02x:%02x", ((i + 1) >> 8) & 0xff, (i + 1) & 0xff);
+        Ptr<LoraNetDevice> lora_net_device = CreateObject<LoraNetDevice> ();
+        lora_net_device->SetMac(CreateObject<ClassAEndDeviceLorawanMac> ());
+        Ptr<LrWpanNetDevice> lr_wpan_net_device = CreateObject<LrWpanNetDevice> ();
+        lr_wpan_net_device->SetAddress(Mac16Address(ble_addr));
+
+        tarako::TarakoNodeData node_data;
+        node_data.id                 = i;
+        node_data.belong_to          = station_id;
+        node_data.position           = Vector(
+            (station % columns) * STATION_SPACING_M + (i % GROUP_SIZE) * NODE_SPACING_M,
+            (station / columns) * STATION_SPACING_M, 0.0
+        );
+        node_data.ble_network_addr   = ble_addr;
+        node_data.lora_network_addr  = i + 1;
+        node_data.lora_net_device    = lora_net_device;
+        node_data.lr_wpan_net_device = lr_wpan_net_device;
+        node_data.activate_time      = Minutes(1);
+        node_data.conn_interval      = Minutes(10);
+        node_data.sensor.current_volume = 0;
+        trace_node_data_map[node_data.lora_network_addr] = node_data;
+    }
+    Engine engine;
+    engine.Setup(trace_node_data_map, "");
+    // Same roles for the legacy run; Setup filled current_status and leader_node_addr
+    std::unordered_map<int, tarako::TarakoNodeData> legacy_node_data_map = trace_node_data_map;
+    const ns3::Time duration = Hours(hours);
+
+    // --- Legacy --- //
+    legacy_fill = CreateObject<UniformRandomVariable> ();
+    for (auto itr = legacy_node_data_map.begin(); itr != legacy_node_data_map.end(); ++itr) {
+        Simulator::Schedule(itr->second.activate_time, &LegacyActivate, &itr->second);
+    }
+    const double legacy_ns = RunSimulation(duration);
+
+    // --- Engine --- //
+    engine.Start();
+    const double engine_ns = RunSimulation(duration);
+    uint64_t engine_activations = 0;
+    for (auto& runtime: engine.GetRuntimes()) engine_activations += runtime.cycle;
+
+    std::printf("nodes: %u, simulated: %.0f h, TarakoConst::EnableGrouping: %d\n",
+                node_num, hours, (int)tarako::TarakoConst::EnableGrouping);
+    std::printf("legacy: %.1f ns/activation (%llu activations)\n",
+                legacy_activations ? legacy_ns / legacy_activations : 0.0, (unsigned long long)legacy_activations);
+    std::printf("engine: %.1f ns/activation (%llu activations)\n",
+                engine_activations ? engine_ns / engine_activations : 0.0, (unsigned long long)engine_activations);
+    if (legacy_activations && engine_activations) {
+        std::printf("speedup: %.2fx\n", (legacy_ns / legacy_activations) / (engine_ns / engine_activations));
+    }
+    return 0;
+}
@@ -0,0 +1,105 @@
+# coding: UTF-8
+# Convert recorded fill logs into the binary fill trace read by tarako_fill_trace.h.
+#
+# Input: CSV rows "station_id,time,volume" sorted by time (unix seconds or
+# "YYYY-mm-dd HH:MM:SS"), volume in L. Logs larger than memory are streamed
+# twice: once for the station table, once for the records. Only one entry per
+# station is kept in memory.
+#
+# usage: python3 fill_trace.py fill_log.csv fill_trace.bin
+#        (sort -t, -k2,2 city_*.csv > fill_log.csv merges per-station logs first)
+import argparse
+import csv
+import struct
+from datetime import datetime
+
+MAGIC = b'TKFT'
+VERSION = 1
+HEADER = struct.Struct('<4sHHIQQ4x')
+STATION = struct.Struct('<8sQ')
+RECORD = struct.Struct('<IIHBx')
+STATION_ID_SIZE = 8
+PATCH_BATCH = 100000
+
+
+def parse_time(value):
+    value = value.strip()
+    if value.isdigit():
+        return int(value)
+    return int(datetime.strptime(value, '%Y-%m-%d %H:%M:%S').timestamp())
+
+
+def read_rows(path):
+    with open(path, 'r', encoding='utf_8') as read_file:
+        for row in csv.reader(read_file):
+            if len(row) < 3 or row[0] == 'station_id':
+                continue
+            yield row[0].strip(), parse_time(row[1]), int(float(row[2]))
+
+
+def scan(path):
+    stations = set()
+    epoch, last, count = None, None, 0
+    for station, time, _ in read_rows(path):
+        if len(station.encode('utf-8')) > STATION_ID_SIZE:
+            raise ValueError('station id longer than {} bytes: {}'.format(STATION_ID_SIZE, station))
+        if last is not None and time < last:
+            raise ValueError('log is not sorted by time at row {}'.format(count + 1))
+        if epoch is None:
+            epoch = time
+        stations.add(station)
+        last = time
+        count += 1
+    return sorted(stations, key=lambda s: s.encode('utf-8')), epoch or 0, count
+
+
+def write_patches(out_file, patches, records_at):
+    # Link the previous record of a station to its successor
+    for index, delta in sorted(patches):
+        out_file.seek(records_at + index * RECORD.size + 4)
+        out_file.write(struct.pack('<I', delta))
+    out_file.seek(0, 2)
+    patches.clear()
+
+
+def convert(src, dst):
+    stations, epoch, count = scan(src)
+    if len(stations) > 0xffff:
+        raise ValueError('more than 65535 stations')
+    station_index = {s: i for i, s in enumerate(stations)}
+    first = [None] * len(stations)
+    last = [None] * len(stations)
+    records_at = HEADER.size + STATION.size * len(stations)
+    with open(dst, 'w+b') as out_file:
+        out_file.write(HEADER.pack(MAGIC, VERSION, RECORD.size, len(stations), count, epoch))
+        out_file.write(b'\0' * STATION.size * len(stations))
+        patches = []
+        for index, (station, time, volume) in enumerate(read_rows(src)):
+            s = station_index[station]
+            if last[s] is None:
+                first[s] = index
+            else:
+                if index - last[s] > 0xffffffff:
+                    raise ValueError('gap between records of {} too large'.format(station))
+                patches.append((last[s], index - last[s]))
+            last[s] = index
+            out_file.write(RECORD.pack(time - epoch, 0, s, max(0, min(volume, 255))))
+            if len(patches) >= PATCH_BATCH:
+                write_patches(out_file, patches, records_at)
+        write_patches(out_file, patches, records_at)
+        out_file.seek(HEADER.size)
+        for s, station in enumerate(stations):
+            out_file.write(STATION.pack(station.encode('utf-8'), first[s]))
+    print('stations: {}, records: {}, epoch: {}'.format(len(stations), count, epoch))
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('src', help='fill log CSV (station_id,time,volume) sorted by time')
+    parser.add_argument('dst', help='binary fill trace')
+    opts = parser.parse_args()
+    convert(opts.src, opts.dst)
+
+
+if __name__ == '__main__':
+    main()
@@ -39,7 +39,12 @@
 #include "ns3/lr-wpan-helper.h"
 #include "ns3/lr-wpan-mac-header.h"
 
+#include "../tarako_engine.h"
+#include "../tarako_heap_counter.h"
+#include "lifetime_estimator.h"
+
 #include <algorithm>
+#include <cmath>
 #include <string>
 #include <vector>
 #include <unordered_map> 
@@ -48,6 +53,22 @@
 using namespace ns3;
 using namespace lorawan;
 
+// --- Scenario Policy --- //
+// One binary per combination; swap policies here instead of TarakoConst flags.
+// The sensor is picked at startup: TraceFill with --fillTrace, RandomFill otherwise.
+template <class Sensor>
+using ScenarioEngine = tarako::TarakoEngine<
+    tarako::policy::StationGrouping,
+    tarako::policy::CsvPairing,
+    tarako::policy::FixedLeader,
+    tarako::policy::ConditionCodec,
+    tarako::policy::PeriodicTrigger,
+    tarako::policy::MultiHopRoute,
+    Sensor
+>;
+typedef ScenarioEngine<tarako::policy::RandomFill> RandomFillEngine;
+typedef ScenarioEngine<tarako::policy::TraceFill>  TraceFillEngine;
+
 // --- Global Object --- //
 tarako::TarakoLogger tarako_logger;
 // --- LoRaWAN Gateway, LoRaWAN & BLE End Device --- //
@@ -80,10 +101,30 @@ const int LORAWAN_GATEWAY_NUM          = 3;
 const int LORAWAN_NETWORK_SERVER_NUM   = 1;
 const double BLE_RX_POWER              = 0.003;
 const double BLE_TX_POWER              = 0.003;
+const double BATTERY_INITIAL_ENERGY_J  = 10000;
+const double SUPPLY_VOLTAGE_V          = 3.3;
+const double LORA_TX_CURRENT_A         = 0.028;
+// Map origin for the metric positions: the gateway (東浦町立北部中学校)
+const double MAP_ORIGIN_LATITUDE       = 34.984811;
+const double MAP_ORIGIN_LONGITUDE      = 136.962978;
+const double EARTH_RADIUS_M            = 6371000;
 // --- Global Variable --- //
 int cnt_node = 0;
 std::vector<tarako::TarakoNodeData> tarako_nodes;
 std::unordered_map<int, tarako::TarakoNodeData> trace_node_data_map;
+// --- Per-interval series (cumulative over all nodes) for warm-up detection --- //
+struct SeriesRow
+{
+    double time;
+    double lora_energy;
+    double ble_energy;
+    uint64_t generated_reports;
+    uint64_t delivered_reports;
+};
+std::vector<SeriesRow> series_rows;
+// --- Heap allocations and uplinks when the first interval is done --- //
+uint64_t warmup_heap_allocations = 0;
+uint64_t warmup_uplinks          = 0;
 
 NS_LOG_COMPONENT_DEFINE ("HeterogeneousWirelessNetworkModel");
 
@@ -92,9 +133,93 @@ static void OnLoRaWANGWReceivedPacket(Ptr<const Packet> packet, const Address& a
     std::cout << "received" << std::endl;
 }
 
+// Latitude/longitude to metres east (x) and north (y) of the map origin.
+// The channels and the BLE routes work on these distances; over a few km the
+// equirectangular projection is off by well under a metre.
+static Vector ToLocalPosition(double latitude, double longitude, double z)
+{
+    const double rad = M_PI / 180;
+    return Vector (EARTH_RADIUS_M * (longitude - MAP_ORIGIN_LONGITUDE) * rad * std::cos(MAP_ORIGIN_LATITUDE * rad),
+                   EARTH_RADIUS_M * (latitude - MAP_ORIGIN_LATITUDE) * rad, z);
+}
+
+template <class Engine>
+static void SampleSeries(const Engine* engine, Time interval)
+{
+    SeriesRow row = {Simulator::Now().GetSeconds(), 0, 0, 0, 0};
+    for (auto& runtime: engine->GetRuntimes()) {
+        row.lora_energy       += runtime.data->lora_energy_consumption;
+        row.ble_energy        += (runtime.ble_sent_packets + runtime.ble_received_packets) * 0.0006;
+        row.generated_reports += runtime.generated_reports;
+        row.delivered_reports += runtime.delivered_reports;
+    }
+    series_rows.push_back(row);
+    Simulator::Schedule(interval, &SampleSeries<Engine>, engine, interval);
+}
+
+template <class Engine>
+static uint64_t CountUplinks(const Engine* engine)
+{
+    uint64_t uplinks = 0;
+    for (auto& runtime: engine->GetRuntimes()) uplinks += runtime.lora_sent_packets + runtime.ble_sent_packets;
+    return uplinks;
+}
+
+template <class Engine>
+static void MarkWarmupEnd(const Engine* engine)
+{
+    warmup_heap_allocations = tarako::GetHeapAllocations();
+    warmup_uplinks          = CountUplinks(engine);
+}
+
+// --- Command line options used after the network is built --- //
+struct ScenarioOptions
+{
+    bool enable_lifetime;
+    int lifetime_window;
+    double lifetime_tolerance;
+    int lifetime_min_uplinks;
+    double simulation_hours;
+    std::string output_prefix;
+    bool enable_series;
+    std::string fill_trace_file;
+    uint32_t trace_start;
+};
+
+template <class Engine>
+static int Simulate(const ScenarioOptions& options, const std::string& pair_file, DeviceEnergyModelContainer& device_energy_models);
+
 
 int main (int argc, char *argv[])
 {
+    // --- Command Line --- //
+    // Lifetime mode: stop once every node is in steady state and project battery lifetime
+    bool enable_lifetime      = false;
+    int lifetime_window       = 3;
+    double lifetime_tolerance = 0.01;
+    int lifetime_min_uplinks  = 20;     // AdrComponent history: 200 min at a 10 min interval
+    double simulation_hours   = 4;
+    // Replica control: fixed output prefix instead of the timestamp, per-interval series
+    std::string output_prefix = "";
+    bool enable_series        = false;
+    // Trace-driven sensors: --fillTrace (binary trace from fill_trace.py) selects the TraceFill engine
+    std::string fill_trace_file = "";
+    uint32_t trace_start        = 0;
+    CommandLine cmd;
+    cmd.AddValue ("lifetime", "Detect steady state and project battery lifetime", enable_lifetime);
+    cmd.AddValue ("lifetimeWindow", "Consecutive schedule blocks that must agree", lifetime_window);
+    cmd.AddValue ("lifetimeTolerance", "Relative tolerance between schedule blocks", lifetime_tolerance);
+    cmd.AddValue ("lifetimeMinUplinks", "LoRaWAN uplinks per node before it can be steady (ADR history)", lifetime_min_uplinks);
+    cmd.AddValue ("hours", "Simulation time (upper bound in lifetime mode)", simulation_hours);
+    cmd.AddValue ("prefix", "Output file prefix (default: current time stamp)", output_prefix);
+    cmd.AddValue ("series", "Write per-interval cumulative energy and reports", enable_series);
+    cmd.AddValue ("fillTrace", "Binary fill trace replayed by TraceFill", fill_trace_file);
+    cmd.AddValue ("traceStart", "Seconds after the trace epoch at simulation start", trace_start);
+    cmd.Parse (argc, argv);
+    if (fill_trace_file.empty() && trace_start != 0) {
+        std::cout << "[error] --traceStart needs --fillTrace" << std::endl;
+        return 1;
+    }
     // --- Logging --- //
     // LogComponentEnable ("HeterogeneousWirelessNetworkModel", LOG_LEVEL_ALL);
     // LogComponentEnable ("TarakoTracer", LOG_LEVEL_ALL);
@@ -118,7 +243,7 @@ int main (int argc, char *argv[])
     std::vector<std::string> skip_ids;
     for (auto g_box: garbage_boxes) {
         if (g_box.burnable) {
-            ns3::Vector3D pos = Vector (g_box.latitude, g_box.longitude,1);
+            ns3::Vector3D pos = ToLocalPosition (g_box.latitude, g_box.longitude, 1);
             ed_allocator->Add (pos);
             
             tarako::TarakoNodeData node;
@@ -129,7 +254,7 @@ int main (int argc, char *argv[])
             cnt_node++;
         }
         if (g_box.incombustible) {
-            ns3::Vector3D pos = Vector (g_box.latitude + 0.003, g_box.longitude,1);
+            ns3::Vector3D pos = ToLocalPosition (g_box.latitude + 0.003, g_box.longitude, 1);
             ed_allocator->Add(pos);
 
             tarako::TarakoNodeData node;
@@ -140,7 +265,7 @@ int main (int argc, char *argv[])
             cnt_node++;
         }
         if (g_box.resource) {
-            ns3::Vector3D pos = Vector (g_box.latitude - 0.003, g_box.longitude,1);
+            ns3::Vector3D pos = ToLocalPosition (g_box.latitude - 0.003, g_box.longitude, 1);
             ed_allocator->Add(pos);
 
             tarako::TarakoNodeData node;
@@ -162,9 +287,9 @@ int main (int argc, char *argv[])
     //gateways.Create (LORAWAN_GATEWAY_NUM);
     gateways.Create (1);
     mobility_gw.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
-    //gw_allocator->Add (Vector (34.969587, 136.924443, 15.0)); // 東浦町立卯ノ里小学校
-    //gw_allocator->Add (Vector (34.953981, 136.962864, 15.0)); // 愛知県立東浦高
-    gw_allocator->Add (Vector (34.984811, 136.962978, 15.0)); // 東浦町立北部中学校
+    //gw_allocator->Add (ToLocalPosition (34.969587, 136.924443, 15.0)); // 東浦町立卯ノ里小学校
+    //gw_allocator->Add (ToLocalPosition (34.953981, 136.962864, 15.0)); // 愛知県立東浦高
+    gw_allocator->Add (ToLocalPosition (34.984811, 136.962978, 15.0)); // 東浦町立北部中学校
     mobility_gw.SetPositionAllocator (gw_allocator);
     mobility_gw.Install (gateways);
 
@@ -179,7 +304,7 @@ int main (int argc, char *argv[])
     Ptr<LoraChannel> channel = CreateObject<LoraChannel> (loss, delay);
     // --- Helper --- //
     lora_phy_helper.SetChannel (channel);
-    lora_helper.EnablePacketTracking();
+    // No packet tracking: LoraPacketTracker keeps every packet alive, which pins the engine's PacketArena
     // --- Install Helper to EndDevices ---
     uint8_t nwk_id    = 54;
     uint32_t nwk_addr = 1864;
@@ -196,13 +321,13 @@ int main (int argc, char *argv[])
     // --- Install EndDevices and Gateway --- //
     lora_mac_helper.SetSpreadingFactorsUp (end_devices, gateways, channel);
     // --- Install Energy Consumption --- //
-    basic_src_helper.Set ("BasicEnergySourceInitialEnergyJ", DoubleValue (10000));
-    basic_src_helper.Set ("BasicEnergySupplyVoltageV", DoubleValue (3.3));
+    basic_src_helper.Set ("BasicEnergySourceInitialEnergyJ", DoubleValue (BATTERY_INITIAL_ENERGY_J));
+    basic_src_helper.Set ("BasicEnergySupplyVoltageV", DoubleValue (SUPPLY_VOLTAGE_V));
     radio_energy_helper.Set ("StandbyCurrentA", DoubleValue (0.0014));
-    radio_energy_helper.Set ("TxCurrentA", DoubleValue (0.028));
+    radio_energy_helper.Set ("TxCurrentA", DoubleValue (LORA_TX_CURRENT_A));
     radio_energy_helper.Set ("SleepCurrentA", DoubleValue (0.0000015));
     radio_energy_helper.Set ("RxCurrentA", DoubleValue (0.0112));
-    radio_energy_helper.SetTxCurrentModel ("ns3::ConstantLoraTxCurrentModel","TxCurrent", DoubleValue (0.028));
+    radio_energy_helper.SetTxCurrentModel ("ns3::ConstantLoraTxCurrentModel","TxCurrent", DoubleValue (LORA_TX_CURRENT_A));
     EnergySourceContainer lora_energy_sources       = basic_src_helper.Install (end_devices);
     Names::Add ("/Names/EnergySource", lora_energy_sources.Get (0));
     DeviceEnergyModelContainer device_energy_models = radio_energy_helper.Install(ed_net_devices, lora_energy_sources);
@@ -265,75 +390,6 @@ int main (int argc, char *argv[])
         lr_wpan_net_device->SetChannel(lr_wpan_channel);
         end_devices.Get(i)->AddDevice(lr_wpan_net_device);
         node_data.lr_wpan_net_device = lr_wpan_net_device;
-        node_data.lr_wpan_net_device->GetMac()->SetMcpsDataConfirmCallback(
-            MakeCallback(&tarako::DataConfirm)
-        );
-        // [Function] Judge it is multiple nodes and target node vector index
-        // [Function] Register Role {Group Leader, Group Member}
-        // 1. Get Pair Group Name && tarako::TarakoConst::EnableGrouping == true
-        const int my_id               = node_data.id;
-        const std::string my_organize = node_data.belong_to;
-        if(tarako::TarakoConst::EnableGrouping && tarako::TarakoConst::EnablePairingGroup) {
-            bool is_adding_node = false;
-            const std::vector<std::string> pair_organizes = tarako::TarakoUtil::GetPairGarbageBox(GARBAGE_BOX_PAIR_FILE, node_data.belong_to);
-            for (auto t_node = tarako_nodes.begin(); t_node != tarako_nodes.end(); t_node++) {
-                // Regist Group Node: (belong to only) or (pair group) 
-                if (t_node->id != my_id) {
-                    if (t_node->belong_to == my_organize) {
-                        is_adding_node = true;
-                    } else {
-                        for (auto org: pair_organizes) {
-                            if (t_node->belong_to.find(org) == 0) {
-                                //std::cout << t_node->belong_to << ","<< org << std::endl;
-                                is_adding_node = true;
-                                break;
-                            }
-                        }
-                    }
-                }
-                if(is_adding_node) {
-                    auto lora_net_addr = ed_net_devices.Get(t_node->id)->GetObject<LoraNetDevice>()->GetMac()->GetObject<EndDeviceLorawanMac>()->GetDeviceAddress().GetNwkAddr();
-                    auto ble_net_addr  = tarako_nodes[t_node->id].ble_network_addr;
-                    node_data.group_node_addrs.push_back({lora_net_addr,ble_net_addr});
-                    is_adding_node = false;
-                }
-            }
-            if(!node_data.group_node_addrs.empty()) {
-                node_data.leader_node_addr = tarako::TarakoUtil::GetFirstLeader(node_data.group_node_addrs,node_data.lora_network_addr, node_data.ble_network_addr);
-                std::cout << node_data.ble_network_addr << "," << node_data.leader_node_addr << std::endl;
-                if (node_data.ble_network_addr.compare(node_data.leader_node_addr) == 0) {
-                    //std::cout << "i am leader" << std::endl;
-                    node_data.current_status = tarako::TarakoNodeStatus::group_leader;
-                } else {
-                    node_data.current_status = tarako::TarakoNodeStatus::group_member;
-                }
-            } else {
-                node_data.current_status = tarako::TarakoNodeStatus::only_lorawan;
-            }
-            // Check Has many node on your garbage box: (single) or (multiple)
-        } else if (tarako::TarakoConst::EnableGrouping) {
-             for (auto t_node = tarako_nodes.begin(); t_node != tarako_nodes.end(); t_node++) {
-                if (t_node->id != my_id) {
-                    if (t_node->belong_to == my_organize) {
-                        auto lora_net_addr = ed_net_devices.Get(t_node->id)->GetObject<LoraNetDevice>()->GetMac()->GetObject<EndDeviceLorawanMac>()->GetDeviceAddress().GetNwkAddr();
-                        auto ble_net_addr  = tarako_nodes[t_node->id].ble_network_addr;
-                        node_data.group_node_addrs.push_back({lora_net_addr,ble_net_addr});
-                    }
-                }
-            }
-            if(!node_data.group_node_addrs.empty()) {
-                node_data.leader_node_addr = tarako::TarakoUtil::GetFirstLeader(node_data.group_node_addrs,node_data.lora_network_addr, node_data.ble_network_addr);
-                if (node_data.ble_network_addr.compare(node_data.leader_node_addr) == 0) {
-                    node_data.current_status = tarako::TarakoNodeStatus::group_leader;
-                } else {
-                    node_data.current_status = tarako::TarakoNodeStatus::group_member;
-                }
-            } else {
-                node_data.current_status = tarako::TarakoNodeStatus::only_lorawan;
-            }
-        } else {
-            node_data.current_status = tarako::TarakoNodeStatus::only_lorawan;
-        }
         // [Init] Garbage Box Sensor
         tarako::GarbageBoxSensor garbage_box_sensor;
         garbage_box_sensor.current_volume = 0;
@@ -341,12 +397,37 @@ int main (int argc, char *argv[])
         node_data.sensor = garbage_box_sensor;
         trace_node_data_map[node_data.lora_network_addr] = node_data;
     }
+    // --- [INIT] Engine: recorded fill levels with --fillTrace, random increments otherwise --- //
+    ScenarioOptions options;
+    options.enable_lifetime      = enable_lifetime;
+    options.lifetime_window      = lifetime_window;
+    options.lifetime_tolerance   = lifetime_tolerance;
+    options.lifetime_min_uplinks = lifetime_min_uplinks;
+    options.simulation_hours     = simulation_hours;
+    options.output_prefix        = output_prefix;
+    options.enable_series        = enable_series;
+    options.fill_trace_file      = fill_trace_file;
+    options.trace_start          = trace_start;
+    if (!fill_trace_file.empty()) return Simulate<TraceFillEngine>(options, GARBAGE_BOX_PAIR_FILE, device_energy_models);
+    return Simulate<RandomFillEngine>(options, GARBAGE_BOX_PAIR_FILE, device_energy_models);
+}
+
+template <class Engine>
+static int Simulate(const ScenarioOptions& options, const std::string& pair_file, DeviceEnergyModelContainer& device_energy_models)
+{
+    // main picks the engine from --fillTrace
+    NS_ASSERT_MSG (Engine::sensor_policy::replays == !options.fill_trace_file.empty(),
+                   "TraceFill engine and --fillTrace must go together");
+    Engine engine;
+    // --- [INIT] Roles {Group Leader, Group Member, Only LoRaWAN} --- //
+    NS_LOG_INFO("[INIT] engine roles");
+    engine.Setup(trace_node_data_map, pair_file);
     // --- [Declare] Trace --- //
-    NS_LOG_INFO("[TRACE] tarako::OnPacketRecievedAtNetworkServer");
+    NS_LOG_INFO("[TRACE] Engine::OnPacketReceivedAtNetworkServer");
     Ptr<NetworkServer> ns = lora_network_apps.Get(0)->GetObject<NetworkServer>();
     ns->TraceConnectWithoutContext(
         "ReceivedPacket", 
-        MakeBoundCallback(&tarako::OnPacketRecievedAtNetworkServerForGroup, &trace_node_data_map)
+        MakeCallback(&Engine::OnPacketReceivedAtNetworkServer, &engine)
     );
     auto cb = MakeCallback(&OnLoRaWANGWReceivedPacket);
     ns->SetStartTime(Seconds(0));
@@ -361,25 +442,70 @@ int main (int argc, char *argv[])
                 &trace_node_data_map.at(itr->second.lora_network_addr)
             )
         );
-        itr->second.lr_wpan_net_device->GetMac()->SetMcpsDataIndicationCallback(
-            MakeBoundCallback(&tarako::DataIndication, &itr->second)
-        );
-        Simulator::Schedule(
-            itr->second.activate_time, 
-            &tarako::OnActivateNodeForGroup, 
-            &itr->second
-        );
     }
+    tarako::FillTrace fill_trace;
+    if (Engine::sensor_policy::replays) {
+        if (!fill_trace.Open(options.fill_trace_file)) {
+            std::cout << "[error] can not read fill trace: " << options.fill_trace_file << std::endl;
+            return 1;
+        }
+        engine.SetFillTrace(&fill_trace, options.trace_start);
+    }
+    engine.Start();
+    // --- [INIT] Lifetime Estimator --- //
+    tarako::LifetimeEstimator lifetime_estimator(
+        BATTERY_INITIAL_ENERGY_J, Minutes(10), options.lifetime_window, options.lifetime_tolerance, options.lifetime_min_uplinks
+    );
+    if (options.enable_lifetime) {
+        Time first_sample = Seconds(0);
+        for (auto itr = trace_node_data_map.begin(); itr != trace_node_data_map.end(); ++itr) {
+            // With equalization the leader rotates through the group, so the schedule
+            // repeats every group size intervals and leader changes are expected.
+            int block_cycles = 1;
+            if (Engine::equalization_policy::rotates && itr->second.current_status != tarako::TarakoNodeStatus::only_lorawan) {
+                block_cycles = itr->second.group_node_addrs.size() + 1;
+            }
+            const typename Engine::NodeRuntime* runtime = engine.GetRuntime(itr->second.lora_network_addr);
+            lifetime_estimator.AddNode(
+                &itr->second, &runtime->lora_sent_packets, &runtime->ble_sent_packets,
+                &runtime->ble_received_packets, &runtime->role, block_cycles
+            );
+            first_sample = std::max(first_sample, itr->second.activate_time);
+        }
+        // Sample half an interval after activation, away from the send events
+        lifetime_estimator.Start(first_sample + Minutes(5));
+    }
+    if (options.enable_series) {
+        Simulator::Schedule(Minutes(1) + Minutes(5), &SampleSeries<Engine>, &engine, Minutes(10));
+    }
+    Simulator::Schedule(Minutes(1) + Minutes(5), &MarkWarmupEnd<Engine>, &engine);
     // [Simulation]
-    Time simulationTime = Hours(4);
+    Time simulationTime = Hours(options.simulation_hours);
     Simulator::Stop (simulationTime);
     Simulator::Run ();
+    const uint64_t heap_allocations = tarako::GetHeapAllocations();
     Simulator::Destroy ();
+    engine.PrintSummary(std::cout);
+    // Whole program: ns-3 stack, engine, lifetime estimator and series alike
+    const uint64_t steady_heap_allocations = heap_allocations - warmup_heap_allocations;
+    const uint64_t steady_uplinks          = CountUplinks(&engine) - warmup_uplinks;
+    std::cout << "[HEAP] allocations: " << heap_allocations << " (after first interval: " << steady_heap_allocations << ", ";
+    std::cout << (steady_uplinks > 0 ? (double)steady_heap_allocations / steady_uplinks : 0.0) << " per uplink)" << std::endl;
+    if (Engine::grouping_policy::enabled) {
+        // Relayed reports replace solo uplinks; each hop (the member's own frame and
+        // every forward) costs one BLE TX and one RX
+        uint64_t relay_hops = 0;
+        for (auto& runtime: engine.GetRuntimes()) relay_hops += runtime.relayed_reports + runtime.ble_forwarded_packets;
+        const double lora_saved_j = engine.GetRelaySavedAirtime() * LORA_TX_CURRENT_A * SUPPLY_VOLTAGE_V;
+        const double relay_ble_j  = relay_hops * 2 * tarako::LifetimeEstimator::BLE_ENERGY_PER_PACKET;
+        std::cout << "[RELAY] LoRaWAN TX energy saved against single-hop: " << lora_saved_j << " J, ";
+        std::cout << "relay BLE energy: " << relay_ble_j << " J, net: " << lora_saved_j - relay_ble_j << " J" << std::endl;
+    }
     // --- Write Log --- //
-    std::string file_prefix         = tarako::TarakoUtil::GetCurrentTimeStamp();
+    std::string file_prefix         = options.output_prefix.empty() ? tarako::TarakoUtil::GetCurrentTimeStamp() : options.output_prefix;
     std::string base_file_name      = "";
-    if (tarako::TarakoConst::EnableGrouping && tarako::TarakoConst::EnableEqualization) base_file_name = "_group_with_eq_log.csv";
-    else if (tarako::TarakoConst::EnableGrouping) base_file_name = "_group_without_eq_log.csv";
+    if (Engine::grouping_policy::enabled && Engine::equalization_policy::rotates) base_file_name = "_group_with_eq_log.csv";
+    else if (Engine::grouping_policy::enabled) base_file_name = "_group_without_eq_log.csv";
     else base_file_name             = "_lorawan_log.csv";
     std::string file_name           = file_prefix + base_file_name;
     const std::string log_file_path = "./scratch/heterogeneous_wireless/" + file_name; 
@@ -408,10 +534,11 @@ int main (int argc, char *argv[])
         *log_stream->GetStream() << itr->second.ble_network_addr << ",";
         *log_stream->GetStream() << std::fixed << itr->second.activate_time.GetSeconds() << ",";
         *log_stream->GetStream() << std::fixed << itr->second.conn_interval.GetSeconds() << ",";
-        if (tarako::TarakoConst::EnableGrouping)
+        if (Engine::grouping_policy::enabled)
         {
-            ble_rx = itr->second.received_packets_by_ble.size() * 0.0006;
-            ble_tx = itr->second.sent_packets_by_ble.size() * 0.0006;
+            const typename Engine::NodeRuntime* runtime = engine.GetRuntime(itr->second.lora_network_addr);
+            ble_rx = runtime->ble_received_packets * 0.0006;
+            ble_tx = runtime->ble_sent_packets * 0.0006;
             itr->second.ble_energy_consumption = ble_tx + ble_rx;
         }
         lora_all = itr->second.lora_energy_consumption;
@@ -425,7 +552,32 @@ int main (int argc, char *argv[])
             *ec_stream->GetStream() << std::fixed << itr->second.id << "," << ec << std::endl;
         }
     }
-    if (tarako::TarakoConst::EnableGrouping) {
+    // SUMMARY
+    uint64_t generated_reports = 0, delivered_reports = 0, lora_uplinks = 0, ble_uplinks = 0;
+    for (auto& runtime: engine.GetRuntimes()) {
+        generated_reports += runtime.generated_reports;
+        delivered_reports += runtime.delivered_reports;
+        lora_uplinks      += runtime.lora_sent_packets;
+        ble_uplinks       += runtime.ble_sent_packets;
+    }
+    Ptr<OutputStreamWrapper> summary_stream = ascii.CreateFileStream("./scratch/heterogeneous_wireless/" + file_prefix + "_summary.csv");
+    *summary_stream->GetStream() << "generated_reports,delivered_reports,lora_uplinks,ble_uplinks,lora_airtime,single_hop_lora_airtime" << std::endl;
+    *summary_stream->GetStream() << generated_reports << "," << delivered_reports << "," << lora_uplinks << "," << ble_uplinks << ",";
+    *summary_stream->GetStream() << engine.GetLoraAirtime() << "," << engine.GetLoraAirtime() + engine.GetRelaySavedAirtime() << std::endl;
+    if (options.enable_series) {
+        Ptr<OutputStreamWrapper> series_stream = ascii.CreateFileStream("./scratch/heterogeneous_wireless/" + file_prefix + "_series.csv");
+        *series_stream->GetStream() << "time,lora_energy,ble_energy,generated_reports,delivered_reports" << std::endl;
+        for (auto& row: series_rows) {
+            *series_stream->GetStream() << std::fixed << row.time << "," << row.lora_energy << "," << row.ble_energy << ",";
+            *series_stream->GetStream() << row.generated_reports << "," << row.delivered_reports << std::endl;
+        }
+    }
+    if (options.enable_lifetime) {
+        const std::string lifetime_file_path     = "./scratch/heterogeneous_wireless/" + file_prefix + "_lifetime.csv";
+        Ptr<OutputStreamWrapper> lifetime_stream = ascii.CreateFileStream(lifetime_file_path);
+        lifetime_estimator.WriteLog(lifetime_stream);
+    }
+    if (Engine::grouping_policy::enabled) {
         std::string base_file_name           = "_group_pair.csv";
         std::string pair_file_name           = file_prefix + base_file_name;
         const std::string pair_file_path     = "./scratch/heterogeneous_wireless/" + pair_file_name; 
@@ -0,0 +1,156 @@
+#include "lifetime_estimator.h"
+
+#include "ns3/simulator.h"
+#include "ns3/end-device-lorawan-mac.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <sstream>
+
+namespace tarako {
+
+LifetimeEstimator::LifetimeEstimator(double initial_energy, ns3::Time cycle, int window, double tolerance, int min_uplinks)
+    : m_initial_energy(initial_energy),
+      m_cycle(cycle),
+      m_window(std::max(2, window)),
+      m_tolerance(tolerance),
+      m_min_uplinks(std::max(0, min_uplinks))
+{
+}
+
+void LifetimeEstimator::AddNode(TarakoNodeData* node, const uint32_t* lora_sent_packets, const uint32_t* ble_sent_packets,
+                                const uint32_t* ble_received_packets, const NodeRole* role, int block_cycles)
+{
+    NodeState state;
+    state.node                 = node;
+    state.lora_sent_packets    = lora_sent_packets;
+    state.ble_sent_packets     = ble_sent_packets;
+    state.ble_received_packets = ble_received_packets;
+    state.role                 = role;
+    state.block_cycles  = std::max(1, block_cycles);
+    state.last_consumed = GetConsumedEnergy(state);
+    state.steady        = false;
+    state.block_energy  = 0;
+    m_states.push_back(state);
+}
+
+void LifetimeEstimator::Start(ns3::Time first_sample)
+{
+    ns3::Simulator::Schedule(first_sample, &LifetimeEstimator::Sample, this);
+}
+
+bool LifetimeEstimator::IsAllSteady() const
+{
+    for (auto& state: m_states) {
+        if (!state.steady) return false;
+    }
+    return !m_states.empty();
+}
+
+ns3::Time LifetimeEstimator::GetLifetime(const NodeState& state) const
+{
+    // Projected from the last sample, so it is still valid after Simulator::Destroy
+    const double remaining = m_initial_energy - state.last_consumed;
+    if (state.block_energy <= 0) return ns3::Time::Max();
+    const double blocks = remaining / state.block_energy;
+    return state.sampled_at + ns3::Seconds(blocks * state.block_cycles * m_cycle.GetSeconds());
+}
+
+double LifetimeEstimator::GetConsumedEnergy(const NodeState& state)
+{
+    const double ble_packets = *state.ble_sent_packets + *state.ble_received_packets;
+    return state.node->lora_energy_consumption + ble_packets * BLE_ENERGY_PER_PACKET;
+}
+
+std::string LifetimeEstimator::GetSignature(const NodeState& state)
+{
+    std::stringstream ss;
+    ss << (int)state.node->lora_net_device->GetMac()->GetObject<ns3::lorawan::EndDeviceLorawanMac>()->GetDataRate();
+    ss << "," << state.role->leader << "," << (int)state.role->path;
+    return ss.str();
+}
+
+void LifetimeEstimator::Sample()
+{
+    for (auto& state: m_states) {
+        const double consumed = GetConsumedEnergy(state);
+        const double delta    = consumed - state.last_consumed;
+        state.last_consumed   = consumed;
+        state.sampled_at      = ns3::Simulator::Now();
+        // --- Perturbation: fall back to full simulation until it settles again --- //
+        // Rotating leaders repeat every block, so compare against the same phase
+        const std::string signature = GetSignature(state);
+        const bool perturbed = state.signatures.size() == (size_t)state.block_cycles
+            && state.signatures.front() != signature;
+        state.signatures.push_back(signature);
+        if (state.signatures.size() > (size_t)state.block_cycles) state.signatures.pop_front();
+        if (perturbed) {
+            state.cycle_energy.clear();
+            state.steady = false;
+            continue;
+        }
+        state.cycle_energy.push_back(delta);
+        const size_t capacity = (size_t)(m_window * state.block_cycles);
+        while (state.cycle_energy.size() > capacity) state.cycle_energy.pop_front();
+        if (state.cycle_energy.size() < capacity) continue;
+        // --- Compare the energy of consecutive schedule blocks --- //
+        std::vector<double> blocks(m_window, 0.0);
+        for (size_t i = 0; i < state.cycle_energy.size(); i++) {
+            blocks[i / state.block_cycles] += state.cycle_energy[i];
+        }
+        const double mean = std::accumulate(blocks.begin(), blocks.end(), 0.0) / blocks.size();
+        bool steady = true;
+        for (auto b: blocks) {
+            if (std::fabs(b - mean) > m_tolerance * std::max(mean, std::numeric_limits<double>::epsilon())) {
+                steady = false;
+                break;
+            }
+        }
+        // ADR may still change the data rate before its history is full
+        if (*state.lora_sent_packets > 0 && *state.lora_sent_packets < m_min_uplinks) steady = false;
+        if (steady && !state.steady) state.steady_at = ns3::Simulator::Now();
+        state.steady       = steady;
+        state.block_energy = mean;
+    }
+    if (IsAllSteady()) {
+        std::cout << "[LIFETIME] all nodes steady at " << ns3::Simulator::Now().GetSeconds() << " s, fast-forward" << std::endl;
+        ns3::Simulator::Stop();
+        return;
+    }
+    ns3::Simulator::Schedule(m_cycle, &LifetimeEstimator::Sample, this);
+}
+
+void LifetimeEstimator::WriteLog(ns3::Ptr<ns3::OutputStreamWrapper> stream) const
+{
+    *stream->GetStream() << "id,lora_network_addr,steady,steady_at,block_cycles,block_energy,lifetime_s,lifetime_days" << std::endl;
+    ns3::Time first_death = ns3::Time::Max();
+    int first_death_id    = -1;
+    for (auto& state: m_states) {
+        const ns3::Time lifetime = state.steady ? GetLifetime(state) : ns3::Time::Max();
+        *stream->GetStream() << state.node->id << ",";
+        *stream->GetStream() << state.node->lora_network_addr << ",";
+        *stream->GetStream() << state.steady << ",";
+        *stream->GetStream() << std::fixed << state.steady_at.GetSeconds() << ",";
+        *stream->GetStream() << state.block_cycles << ",";
+        *stream->GetStream() << state.block_energy << ",";
+        if (state.steady) {
+            *stream->GetStream() << lifetime.GetSeconds() << "," << lifetime.GetDays() << std::endl;
+        } else {
+            *stream->GetStream() << ",," << std::endl;
+        }
+        if (state.steady && lifetime < first_death) {
+            first_death    = lifetime;
+            first_death_id = state.node->id;
+        }
+    }
+    if (first_death_id >= 0) {
+        std::cout << "[LIFETIME] first death: node " << first_death_id << " after " << first_death.GetDays() << " days" << std::endl;
+    } else {
+        std::cout << "[LIFETIME] no steady node, lifetime not projected" << std::endl;
+    }
+}
+
+} // namespace tarako
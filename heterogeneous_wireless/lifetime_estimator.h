@@ -0,0 +1,86 @@
+/*
+ * Steady-state detection and battery lifetime projection.
+ *
+ * Every connection interval the estimator samples the energy consumed by each
+ * node and compares consecutive schedule blocks (one block is the number of
+ * intervals after which the node's group-role schedule repeats). Once the last
+ * blocks agree, the node is steady and its lifetime against the battery is
+ * projected analytically. The role of every sample (data rate, leader and
+ * report path from the engine runtime) is compared with the sample one block
+ * earlier, at the same phase of the schedule. A change there (ADR, a leader
+ * that leaves the rotation, a LoRaWAN fallback) resets the node, so the
+ * simulation keeps running in full until the new cycle has settled. When all
+ * nodes are steady the simulation is stopped.
+ *
+ * ADR only acts once the network server holds a full history of a device's
+ * uplinks (AdrComponent: 20). Until a node has sent min_uplinks LoRaWAN
+ * uplinks its data rate may still change, so it is not declared steady and
+ * the run is not stopped. Nodes that send no LoRaWAN uplink are not held back.
+ */
+#ifndef TARAKO_LIFETIME_ESTIMATOR_H
+#define TARAKO_LIFETIME_ESTIMATOR_H
+
+#include "../tarako_engine.h"
+
+#include "ns3/node_payload.h"
+#include "ns3/group_node.h"
+#include "ns3/nstime.h"
+#include "ns3/output-stream-wrapper.h"
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace tarako {
+
+class LifetimeEstimator
+{
+public:
+    // Per-report BLE energy, same as the post-processing in heterogeneous_wireless.cc
+    static constexpr double BLE_ENERGY_PER_PACKET = 0.0006;
+
+    struct NodeState
+    {
+        TarakoNodeData* node;
+        const uint32_t* lora_sent_packets;     // engine counters, packets are not kept
+        const uint32_t* ble_sent_packets;
+        const uint32_t* ble_received_packets;
+        const NodeRole* role;                  // engine runtime role of the last activation
+        int block_cycles;               // intervals until the role schedule repeats
+        std::deque<std::string> signatures;    // data rate + role of the last block_cycles samples
+        double last_consumed;
+        ns3::Time sampled_at;
+        std::deque<double> cycle_energy;
+        bool steady;
+        ns3::Time steady_at;
+        double block_energy;            // [J] per block_cycles intervals
+    };
+
+    LifetimeEstimator(double initial_energy, ns3::Time cycle, int window, double tolerance, int min_uplinks);
+
+    void AddNode(TarakoNodeData* node, const uint32_t* lora_sent_packets, const uint32_t* ble_sent_packets,
+                 const uint32_t* ble_received_packets, const NodeRole* role, int block_cycles);
+    void Start(ns3::Time first_sample);
+    bool IsAllSteady() const;
+    // Projected time of death from simulation start, only valid for steady nodes
+    ns3::Time GetLifetime(const NodeState& state) const;
+    void WriteLog(ns3::Ptr<ns3::OutputStreamWrapper> stream) const;
+
+    static double GetConsumedEnergy(const NodeState& state);
+
+private:
+    void Sample();
+    static std::string GetSignature(const NodeState& state);
+
+    double m_initial_energy;
+    ns3::Time m_cycle;
+    int m_window;
+    double m_tolerance;
+    uint32_t m_min_uplinks;     // LoRaWAN uplinks before a node can be steady (ADR history)
+    std::vector<NodeState> m_states;
+};
+
+} // namespace tarako
+
+#endif // TARAKO_LIFETIME_ESTIMATOR_H
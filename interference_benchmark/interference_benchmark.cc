@@ -0,0 +1,151 @@
+/*
+ * Stress benchmark of gateway interference tracking.
+ *
+ * Thousands of end devices activate inside the same Minutes(1) window every
+ * connection interval, like end_devices in heterogeneous_wireless.cc. Every
+ * uplink is tracked at one gateway and checked at the end of its reception.
+ * "list" mirrors LoraInterferenceHelper (one event list, old events cleaned on
+ * add, full scan per check); "interval" is tarako::IntervalInterferenceTracker.
+ * Both must give the same verdict for every uplink.
+ *
+ * usage: ./waf --run "interference_benchmark --devices=5000 --cycles=6"
+ */
+#include "../tarako_interference.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <random>
+#include <vector>
+
+using namespace tarako;
+
+namespace {
+
+const int64_t NS_PER_S = 1000000000LL;
+
+class ListInterferenceTracker
+{
+public:
+    void Add(const InterferenceEvent& event)
+    {
+        CleanOldEvents(event.start);
+        m_events.push_back(event);
+    }
+
+    bool IsDestroyedByInterference(const InterferenceEvent& event) const
+    {
+        const double signal = (double)(event.end - event.start) * DbmToW(event.rx_power);
+        double interference[6] = {0, 0, 0, 0, 0, 0};
+        for (auto& other: m_events) {
+            if (other.id == event.id || other.frequency != event.frequency) continue;
+            interference[other.sf - 7] += GetOverlap(event, other) * DbmToW(other.rx_power);
+        }
+        for (uint8_t sf = 7; sf <= 12; sf++) {
+            if (interference[sf - 7] <= 0) continue;
+            const double snir = 10 * std::log10(signal / interference[sf - 7]);
+            if (snir < LORA_COLLISION_SNIR[event.sf - 7][sf - 7]) return true;
+        }
+        return false;
+    }
+
+private:
+    // LoraInterferenceHelper::oldEventThreshold
+    static const int64_t OLD_EVENT_THRESHOLD = 2 * NS_PER_S;
+
+    // Same rule as LoraInterferenceHelper::CleanOldEvents: end + threshold < now
+    void CleanOldEvents(int64_t now)
+    {
+        for (auto itr = m_events.begin(); itr != m_events.end();) {
+            if (itr->end + OLD_EVENT_THRESHOLD < now) itr = m_events.erase(itr);
+            else ++itr;
+        }
+    }
+
+    std::list<InterferenceEvent> m_events;
+};
+
+struct Step
+{
+    int64_t time;
+    bool is_end;
+    size_t index;
+};
+
+template <class Tracker>
+double Replay(const std::vector<InterferenceEvent>& events, const std::vector<Step>& steps,
+              std::vector<char>& destroyed)
+{
+    Tracker tracker;
+    destroyed.assign(events.size(), 0);
+    const auto begin = std::chrono::steady_clock::now();
+    for (auto& step: steps) {
+        if (step.is_end) destroyed[step.index] = tracker.IsDestroyedByInterference(events[step.index]);
+        else tracker.Add(events[step.index]);
+    }
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+
+} // namespace
+
+int main (int argc, char *argv[])
+{
+    size_t device_num = 5000;
+    int cycles        = 6;
+    bool mixed_sf     = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strncmp(argv[i], "--devices=", 10) == 0) device_num = std::strtoul(argv[i] + 10, nullptr, 10);
+        if (std::strncmp(argv[i], "--cycles=", 9) == 0) cycles = std::atoi(argv[i] + 9);
+        if (std::strcmp(argv[i], "--mixedSf") == 0) mixed_sf = true;
+    }
+    // --- Synchronized activations: all devices inside Minutes(1), every Minutes(10) --- //
+    const double channels[3] = {868.1, 868.3, 868.5};
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> jitter(0.0, 60.0);
+    std::uniform_real_distribution<double> power(-130.0, -60.0);
+    std::uniform_int_distribution<int> channel(0, 2);
+    std::uniform_int_distribution<int> sf(7, 12);
+    std::vector<InterferenceEvent> events;
+    for (int c = 0; c < cycles; c++) {
+        for (size_t d = 0; d < device_num; d++) {
+            InterferenceEvent event;
+            // DR5 (SF7) as set by SetDataRate(5), optionally mixed SF after ADR
+            event.sf        = mixed_sf ? (uint8_t)sf(rng) : 7;
+            event.start     = (int64_t)((60 + c * 600 + jitter(rng)) * NS_PER_S);
+            event.end       = event.start + GetLoraOnAirTime(event.sf, 3 + 13);
+            event.rx_power  = power(rng);
+            event.frequency = channels[channel(rng)];
+            event.id        = events.size();
+            events.push_back(event);
+        }
+    }
+    std::vector<Step> steps;
+    for (size_t i = 0; i < events.size(); i++) {
+        steps.push_back({events[i].start, false, i});
+        steps.push_back({events[i].end, true, i});
+    }
+    std::sort(steps.begin(), steps.end(), [](const Step& a, const Step& b) {
+        if (a.time != b.time) return a.time < b.time;
+        if (a.is_end != b.is_end) return a.is_end < b.is_end;
+        return a.index < b.index;
+    });
+
+    std::vector<char> list_destroyed, interval_destroyed;
+    const double list_ms     = Replay<ListInterferenceTracker>(events, steps, list_destroyed);
+    const double interval_ms = Replay<IntervalInterferenceTracker>(events, steps, interval_destroyed);
+    size_t lost = 0, mismatch = 0;
+    for (size_t i = 0; i < events.size(); i++) {
+        lost += list_destroyed[i];
+        mismatch += list_destroyed[i] != interval_destroyed[i];
+    }
+    std::printf("devices: %zu, cycles: %d, uplinks: %zu, lost by interference: %zu\n",
+                device_num, cycles, events.size(), lost);
+    std::printf("list:     %.1f ms\n", list_ms);
+    std::printf("interval: %.1f ms\n", interval_ms);
+    std::printf("speedup:  %.1fx, verdict mismatches: %zu\n", list_ms / interval_ms, mismatch);
+    return mismatch == 0 ? 0 : 1;
+}
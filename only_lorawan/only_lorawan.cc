@@ -5,7 +5,8 @@
 
 #include "ns3/csv.h"
 #include "ns3/garbage_station.h"
-#include "ns3/node_info.h"
+
+#include "../tarako_engine.h"
 
 #include "ns3/end-device-lora-phy.h"
 #include "ns3/gateway-lora-phy.h"
@@ -59,53 +60,16 @@ const int INCOMBUSTIBLE = 4;
 const int RESOURCE = 5;
 // Simulation Parameter
 const ns3::Time INTERVAL = Minutes(10);
-const unsigned int GARBAGE_BOX_VOLUME = 70; // UNIT: L
-
-enum GarbageBoxCondition: unsigned int
-{
-    EMPTY = 0, 
-    FILLED = 1, 
-    FULL = 2
-};
-// Garbage Helper
-struct OnlyLoRaWANPayload 
-{
-    GarbageBoxCondition c;
-};
-
-struct GarbageSensor
-{
-    unsigned int current_volume;
-};
-
-GarbageBoxCondition 
-JudgeGarbageBoxCondition(GarbageSensor* gs, unsigned int inc)
-{
-    if (gs->current_volume == 0) 
-    {
-        gs->current_volume = gs->current_volume + inc;
-        return GarbageBoxCondition::EMPTY;
-    }
-    else if (0 < gs->current_volume && gs->current_volume < GARBAGE_BOX_VOLUME) 
-    {
-        gs->current_volume = gs->current_volume + inc;
-        return GarbageBoxCondition::FILLED;
-    } 
-    else
-    {
-        gs->current_volume = 0;
-        return GarbageBoxCondition::FULL;
-    } 
-}
 
-unsigned int 
-CreaterRandomValue()
-{
-    std::random_device rd;
-	std::mt19937 mt(rd());
-	std::uniform_int_distribution<int> dice(1,5);
-    return dice(mt);
-}
+// --- Scenario Policy --- //
+// Every node reports its own condition directly over LoRaWAN, in the 4-byte payload of the old scenario
+typedef tarako::TarakoEngine<
+    tarako::policy::NoGrouping,
+    tarako::policy::NoPairing,
+    tarako::policy::FixedLeader,
+    tarako::policy::LegacyConditionCodec,
+    tarako::policy::PeriodicTrigger
+> Engine;
 
 NS_LOG_COMPONENT_DEFINE ("OnlyLoRaWANNetworkModel");
 
@@ -121,36 +85,9 @@ bool is_supported_garbage_type(std::string value)
     else return false;
 }
 // --- Trace Callback Fuction --- //
-void OnLoRaWANEnergyConsumptionChange (NodeInfo* node, double oldEnergyConsumption, double newEnergyConsumption)
-{
-  ostringstream oss;
-  node->energy_consumption = newEnergyConsumption;
-}
-
-void OnPacketRecieved (unordered_map<int, NodeInfo>* node_map, Ptr<Packet const> packet) {
-    // Remove Header From Wrapper Packet
-    LorawanMacHeader mHdr;
-    LoraFrameHeader fHdr;
-    Ptr<Packet> myPacket = packet->Copy ();
-    myPacket->RemoveHeader (mHdr);
-    myPacket->RemoveHeader (fHdr);
-    node_map->at(int(fHdr.GetAddress().GetNwkAddr())).recieved_packets.push_back(packet->Copy());
-    // Print Payload from Recieved Packet
-    uint8_t *buffer = new uint8_t[myPacket->GetSize()];
-    myPacket->CopyData(buffer, myPacket->GetSize());
-    OnlyLoRaWANPayload payload;
-    memcpy(&payload, buffer, sizeof(payload));
-}
-
-void OnActivate (Ptr<LoraNetDevice> device, GarbageSensor* gs, NodeInfo* node) 
+void OnLoRaWANEnergyConsumptionChange (TarakoNodeData* node, double oldEnergyConsumption, double newEnergyConsumption)
 {
-    unsigned int random_value = CreaterRandomValue();
-    GarbageBoxCondition condition =  JudgeGarbageBoxCondition(gs, random_value);
-    OnlyLoRaWANPayload payload = OnlyLoRaWANPayload{condition};
-    Ptr<Packet> new_packet = Create<Packet>((uint8_t *)&payload, sizeof(payload));
-    device->Send(new_packet);
-    node->sent_packets.push_back(new_packet);
-    Simulator::Schedule(INTERVAL, &OnActivate, device, gs, node);
+  node->lora_energy_consumption = newEnergyConsumption;
 }
 
 void OnMacAttached(Ptr<LorawanMac> mac)
@@ -159,7 +96,7 @@ void OnMacAttached(Ptr<LorawanMac> mac)
 }
 
 // --- Logging ---
-void WriteLog(unordered_map<int, NodeInfo> node_map)
+void WriteLog(unordered_map<int, TarakoNodeData>& node_map, Engine& engine)
 {
     // init energy consumption
     string energy_consumption_file = "./scratch/result_energy_consumption.csv";
@@ -169,23 +106,18 @@ void WriteLog(unordered_map<int, NodeInfo> node_map)
     for (auto itr = node_map.begin(); itr != node_map.end(); ++itr)
     {
         int nwk_addr = itr->first;
-        NodeInfo node_info = itr->second;
-        *e_stream->GetStream () << nwk_addr << "," << node_info.energy_consumption << endl;
+        const TarakoNodeData& node_data = itr->second;
+        *e_stream->GetStream () << nwk_addr << "," << node_data.lora_energy_consumption << endl;
         //
         std::stringstream node_packet_info_file;
         node_packet_info_file << "./scratch/" << nwk_addr << "_node_packet_info.csv";
         Ptr<OutputStreamWrapper> n_stream = ascii.CreateFileStream(node_packet_info_file.str()); // "Col(0): Node DeviceAddr, Col(1): EnergyConsumption(mA)
 
-        for (auto& packet: node_info.recieved_packets)
+        for (auto& frame: engine.GetRuntime(nwk_addr)->received_frames)
         {
-            LorawanMacHeader mHdr;
-            LoraFrameHeader fHdr;
-            Ptr<Packet> myPacket = packet->Copy ();
-            myPacket->RemoveHeader (mHdr);
-            myPacket->RemoveHeader (fHdr);
             *n_stream->GetStream() << nwk_addr << ",";
-            *n_stream->GetStream() << packet->GetUid() << ",";
-            *n_stream->GetStream() << fHdr.GetFCnt() << endl;
+            *n_stream->GetStream() << frame.first << ",";
+            *n_stream->GetStream() << frame.second << endl;
         }
         cout << "done: write " << node_packet_info_file.str() << endl;
     }
@@ -197,7 +129,6 @@ int main (int argc, char *argv[])
     LogComponentEnable ("OnlyLoRaWANNetworkModel", LOG_LEVEL_ALL);
     LogComponentEnable ("AdrComponent", LOG_LEVEL_ALL);
     LogComponentEnable ("EndDeviceLorawanMac", LOG_LEVEL_ALL);
-    LogComponentEnable ("LoraPacketTracker", LOG_LEVEL_ALL);
     LogComponentEnable("GatewayLorawanMac", LOG_LEVEL_ALL);
     LogComponentEnable("NetworkServer", LOG_LEVEL_ALL);
     LogComponentEnableAll (LOG_PREFIX_FUNC);
@@ -246,18 +177,22 @@ int main (int argc, char *argv[])
     // Create Garbage Station Position
     Ptr<ListPositionAllocator> allocator = CreateObject<ListPositionAllocator> ();
     int cnt_node = 0;
+    vector<string> node_stations;
     
     for (const auto& g_station: g_stations) {
         if (g_station.burnable) {
             allocator->Add (Vector (g_station.latitude, g_station.longitude,0));
+            node_stations.push_back(g_station.id);
             cnt_node++;
         }
         if (g_station.incombustible) {
             allocator->Add (Vector (g_station.latitude + 0.000001, g_station.longitude,0));
+            node_stations.push_back(g_station.id);
             cnt_node++;
         }
         if (g_station.resource) {
             allocator->Add (Vector (g_station.latitude + 0.000002, g_station.longitude,0));
+            node_stations.push_back(g_station.id);
             cnt_node++;
         }
     }
@@ -287,7 +222,7 @@ int main (int argc, char *argv[])
     // Create the LorawanMacHelper
     LorawanMacHelper macHelper = LorawanMacHelper ();
     LoraHelper helper = LoraHelper ();
-    helper.EnablePacketTracking();
+    // No packet tracking: LoraPacketTracker keeps every packet alive, which pins the engine's PacketArena
     
     // --- Gateway ---
     NodeContainer gateways;
@@ -349,42 +284,61 @@ int main (int argc, char *argv[])
     forwarderHelper.Install (gateways);
 
     // --- Connect out traces ---
-    // Recieved Packet 
-    unordered_map<int, NodeInfo> node_map;
-    unordered_map<int, GarbageSensor> garbage_sensor_map;
+    unordered_map<int, TarakoNodeData> node_map;
+    Engine engine;
 
-    Ptr<NetworkServer> ns = nsModels.Get(0)->GetObject<NetworkServer>();
-    ns->TraceConnectWithoutContext("ReceivedPacket", MakeBoundCallback(&OnPacketRecieved, &node_map));
     // Energy Consumption & Schedule Sending Packet
     for (int i=0; i < (int)endDevicesNetDevices.GetN(); i++) {
         Ptr<LoraNetDevice> lora_net_device = endDevicesNetDevices.Get(i)->GetObject<LoraNetDevice>();
         uint32_t nwk_addr = lora_net_device->GetMac()->GetObject<EndDeviceLorawanMac>()->GetDeviceAddress().GetNwkAddr();
         
-        // init node info
-        NodeInfo node_info;
-        node_info.id = i;
-        node_map[int(nwk_addr)] = node_info;
+        // init node data
+        TarakoNodeData node_data;
+        node_data.id                      = i;
+        node_data.position                = endDevices.Get(i)->GetObject<MobilityModel>()->GetPosition();
+        node_data.belong_to               = node_stations[i];
+        node_data.activate_time           = Seconds(60*i+1);
+        node_data.conn_interval           = INTERVAL;
+        node_data.lora_net_device         = lora_net_device;
+        node_data.lora_network_addr       = nwk_addr;
+        node_data.lora_energy_consumption = 0;
+        // engine lookup key; the legacy payload itself carries no address
+        std::stringstream stream;
+        stream << std::hex << i+1;
+        std::string s( stream.str());
+        while (s.size() < 4)
+          s.insert(0,1,'0');
+        s.insert(2,1,':');
+        node_data.ble_network_addr = s;
+        // init garbage sensor
+        node_data.sensor.current_volume = 0;
+        node_map[int(nwk_addr)] = node_data;
         deviceModels.Get(i) -> TraceConnectWithoutContext(
             "TotalEnergyConsumption", 
             MakeBoundCallback(&OnLoRaWANEnergyConsumptionChange, &node_map.at(int(nwk_addr)))
         );
-        // init garbage sensor
-        GarbageSensor garbage_sensor;
-        garbage_sensor.current_volume = 0;
-        garbage_sensor_map[int(nwk_addr)] = garbage_sensor;
-
-        ns3::Time activate_time = Seconds(60*i+1);
-        Simulator::Schedule(activate_time, &OnActivate, lora_net_device, &garbage_sensor_map.at(int(nwk_addr)), &node_map.at(int(nwk_addr)));
     }
+    engine.Setup(node_map, "");
+    // WriteLog lists every received frame per node
+    engine.SetKeepReceivedFrames(true);
+    Ptr<NetworkServer> ns = nsModels.Get(0)->GetObject<NetworkServer>();
+    ns->TraceConnectWithoutContext("ReceivedPacket", MakeCallback(&Engine::OnPacketReceivedAtNetworkServer, &engine));
+    engine.Start();
     // --- Simulation ---
     Time simulationTime = Hours(24);
     Simulator::Stop (simulationTime);
     Simulator::Run ();
     Simulator::Destroy ();
+    engine.PrintSummary(std::cout);
     // --- Write Log ---
-    WriteLog(node_map);
-    LoraPacketTracker &tracker = helper.GetPacketTracker ();
-    std::cout << tracker.CountMacPacketsGlobally (Seconds (0), simulationTime + Minutes (1)) << std::endl;
+    WriteLog(node_map, engine);
+    // Sent and received uplinks, as LoraPacketTracker::CountMacPacketsGlobally printed them
+    uint64_t sent = 0, received = 0;
+    for (auto& runtime: engine.GetRuntimes()) {
+        sent     += runtime.lora_sent_packets;
+        received += runtime.received_frames.size();
+    }
+    std::cout << sent << " " << received << std::endl;
 
     return 0;
 }
\ No newline at end of file
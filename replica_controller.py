@@ -0,0 +1,222 @@
+# coding: UTF-8
+# Sequential-stopping replica controller for heterogeneous_wireless.
+#
+# Replicas (--RngRun=1,2,...) of every configuration run in parallel on local
+# cores. Key metrics of each finished replica are streamed into running
+# estimators, and a configuration stops receiving replicas once the confidence
+# interval of every metric is within --target relative half-width. Free cores
+# always go to the configuration whose widest interval is the largest.
+#
+# usage (from the ns-3.30 root):
+#   python3 scratch/replica_controller.py --config "--hours=4" --config "--hours=24" --target 0.05 --warmup
+import argparse
+import csv
+import math
+import os
+import statistics
+import subprocess
+from concurrent.futures import FIRST_COMPLETED, ThreadPoolExecutor, wait
+
+SCENARIO = 'heterogeneous_wireless'
+LOG_DIR = './scratch/heterogeneous_wireless/'
+METRICS = ['mean_energy', 'p95_energy', 'lora_share', 'delivery_ratio']
+MSER_BATCH = 5
+
+
+class RunningEstimator:
+    """Welford mean/variance with a Student-t confidence interval."""
+
+    def __init__(self):
+        self.n = 0
+        self.mean = 0.0
+        self.m2 = 0.0
+
+    def add(self, x):
+        self.n += 1
+        delta = x - self.mean
+        self.mean += delta / self.n
+        self.m2 += delta * (x - self.mean)
+
+    def half_width(self, confidence):
+        if self.n < 2:
+            return math.inf
+        sd = math.sqrt(self.m2 / (self.n - 1))
+        return t_quantile(confidence, self.n - 1) * sd / math.sqrt(self.n)
+
+    def relative_half_width(self, confidence):
+        hw = self.half_width(confidence)
+        if math.isinf(hw):
+            return math.inf
+        if self.mean == 0:
+            return 0.0 if hw == 0 else math.inf
+        return hw / abs(self.mean)
+
+
+def t_quantile(confidence, df):
+    # Cornish-Fisher expansion of the Student-t quantile around the normal one
+    z = statistics.NormalDist().inv_cdf(0.5 + confidence / 2)
+    return z + (z ** 3 + z) / (4 * df) + (5 * z ** 5 + 16 * z ** 3 + 3 * z) / (96 * df ** 2)
+
+
+def mser_truncation(values):
+    """MSER-5: number of leading samples to drop as warm-up."""
+    batches = [sum(values[i:i + MSER_BATCH]) / MSER_BATCH
+               for i in range(0, len(values) - MSER_BATCH + 1, MSER_BATCH)]
+    if len(batches) < 4:
+        return 0
+    best_d, best = 0, math.inf
+    for d in range(len(batches) // 2 + 1):
+        rest = batches[d:]
+        mean = sum(rest) / len(rest)
+        score = sum((b - mean) ** 2 for b in rest) / len(rest) ** 2
+        if score < best:
+            best_d, best = d, score
+    return best_d * MSER_BATCH
+
+
+def percentile(values, q):
+    ordered = sorted(values)
+    if not ordered:
+        return 0.0
+    k = (len(ordered) - 1) * q
+    lo, hi = int(math.floor(k)), int(math.ceil(k))
+    return ordered[lo] + (ordered[hi] - ordered[lo]) * (k - lo)
+
+
+def read_csv(path):
+    with open(path, 'r', encoding='utf_8') as read_file:
+        return list(csv.DictReader(read_file))
+
+
+def find_log(prefix):
+    for suffix in ['_group_with_eq_log.csv', '_group_without_eq_log.csv', '_lorawan_log.csv']:
+        if os.path.exists(LOG_DIR + prefix + suffix):
+            return LOG_DIR + prefix + suffix
+    raise FileNotFoundError(prefix)
+
+
+def collect_metrics(prefix, warmup):
+    nodes = read_csv(find_log(prefix))
+    total = [float(r['total_energy_consumption']) for r in nodes]
+    lora = sum(float(r['lora_energy_consumption']) for r in nodes)
+    summary = read_csv(LOG_DIR + prefix + '_summary.csv')[0]
+    generated = int(summary['generated_reports'])
+    delivered = int(summary['delivered_reports'])
+    metrics = {
+        'mean_energy': sum(total) / len(total),
+        'p95_energy': percentile(total, 0.95),
+        'lora_share': lora / sum(total) if sum(total) > 0 else 0.0,
+        'delivery_ratio': delivered / generated if generated > 0 else 0.0,
+        'truncated': 0,
+    }
+    if not warmup:
+        return metrics
+    # Steady-state rates from the per-interval series, warm-up removed by MSER-5
+    series = read_csv(LOG_DIR + prefix + '_series.csv')
+    energy = [float(r['lora_energy']) + float(r['ble_energy']) for r in series]
+    increments = [b - a for a, b in zip(energy, energy[1:])]
+    d = mser_truncation(increments)
+    first, last = series[d], series[-1]
+    intervals = len(series) - 1 - d
+    if intervals <= 0:
+        return metrics
+    d_lora = float(last['lora_energy']) - float(first['lora_energy'])
+    d_total = d_lora + float(last['ble_energy']) - float(first['ble_energy'])
+    d_generated = int(last['generated_reports']) - int(first['generated_reports'])
+    d_delivered = int(last['delivered_reports']) - int(first['delivered_reports'])
+    metrics['mean_energy'] = d_total / (len(nodes) * intervals)
+    metrics['lora_share'] = d_lora / d_total if d_total > 0 else 0.0
+    metrics['delivery_ratio'] = d_delivered / d_generated if d_generated > 0 else 0.0
+    metrics['truncated'] = d
+    return metrics
+
+
+def run_replica(config_index, config, run, warmup):
+    prefix = 'replica_c{}_r{}'.format(config_index, run)
+    args = '{} {} --RngRun={} --prefix={}'.format(SCENARIO, config, run, prefix)
+    if warmup:
+        args += ' --series=1'
+    result = subprocess.run(['./waf', '--run-no-build', args], stdout=subprocess.PIPE, stderr=subprocess.STDOUT)
+    if result.returncode != 0:
+        raise RuntimeError('{} failed:\n{}'.format(args, result.stdout.decode('utf-8', 'replace')))
+    return config_index, run, collect_metrics(prefix, warmup)
+
+
+class Configuration:
+    def __init__(self, index, args):
+        self.index = index
+        self.args = args
+        self.estimators = {m: RunningEstimator() for m in METRICS}
+        self.next_run = 1
+        self.in_flight = 0
+
+    def width(self, confidence):
+        return max(e.relative_half_width(confidence) for e in self.estimators.values())
+
+    def is_uncertain(self, opts):
+        done = self.estimators[METRICS[0]].n
+        if done >= opts.max_replicas:
+            return False
+        return done < opts.min_replicas or self.width(opts.confidence) > opts.target
+
+    def wants_replica(self, opts):
+        launched = self.estimators[METRICS[0]].n + self.in_flight
+        if launched >= opts.max_replicas:
+            return False
+        if launched < opts.min_replicas:
+            return True
+        # Do not queue more than one extra replica per result still pending
+        return self.is_uncertain(opts) and self.in_flight < max(1, opts.jobs // 2)
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('--config', action='append', default=None, help='scenario arguments of one configuration')
+    parser.add_argument('--target', type=float, default=0.05, help='relative CI half-width to stop at')
+    parser.add_argument('--confidence', type=float, default=0.95)
+    parser.add_argument('--min-replicas', dest='min_replicas', type=int, default=5)
+    parser.add_argument('--max-replicas', dest='max_replicas', type=int, default=100)
+    parser.add_argument('--jobs', type=int, default=os.cpu_count())
+    parser.add_argument('--warmup', action='store_true', help='truncate warm-up with MSER-5')
+    parser.add_argument('--out', default=LOG_DIR + 'replicas.csv')
+    opts = parser.parse_args()
+
+    configs = [Configuration(i, a) for i, a in enumerate(opts.config or [''])]
+    subprocess.run(['./waf', 'build'], check=True)
+
+    with open(opts.out, 'w') as out_file, ThreadPoolExecutor(max_workers=opts.jobs) as pool:
+        writer = csv.writer(out_file)
+        writer.writerow(['config', 'run'] + METRICS + ['truncated'])
+        pending = set()
+        while True:
+            # Fill free cores, widest confidence interval first
+            while len(pending) < opts.jobs:
+                candidates = [c for c in configs if c.wants_replica(opts)]
+                if not candidates:
+                    break
+                config = max(candidates, key=lambda c: c.width(opts.confidence))
+                pending.add(pool.submit(run_replica, config.index, config.args, config.next_run, opts.warmup))
+                config.next_run += 1
+                config.in_flight += 1
+            if not pending:
+                break
+            done, pending = wait(pending, return_when=FIRST_COMPLETED)
+            for future in done:
+                index, run, metrics = future.result()
+                config = configs[index]
+                config.in_flight -= 1
+                for m in METRICS:
+                    config.estimators[m].add(metrics[m])
+                writer.writerow([index, run] + [metrics[m] for m in METRICS] + [metrics['truncated']])
+                out_file.flush()
+                print('[config {}] run {} done, widest CI: {:.3f}'.format(index, run, config.width(opts.confidence)))
+
+    for config in configs:
+        print('[config {}] "{}" replicas: {}'.format(config.index, config.args, config.estimators[METRICS[0]].n))
+        for m in METRICS:
+            e = config.estimators[m]
+            print('  {:15s} {:.6f} +/- {:.6f}'.format(m, e.mean, e.half_width(opts.confidence)))
+
+
+if __name__ == '__main__':
+    main()
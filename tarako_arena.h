@@ -0,0 +1,111 @@
+/*
+ * Per-run packet arena for the tarako send paths.
+ *
+ * Packets handed to LoraNetDevice::Send and LrWpanMac::McpsDataRequest are
+ * reference counted and released once the stack is done with them (a few
+ * seconds after the uplink, well before the next connection interval). The
+ * arena keeps every packet it ever created. Handed-out slots wait in a ring
+ * in send order. When no slot is free, Acquire walks every slot in the ring
+ * once: released ones move to a free list, held ones (MAC retransmissions)
+ * go back into the ring. Only when none was released does the arena grow.
+ * A packet is rebuilt in place from the payload buffer in a free slot. A
+ * packet kept for the whole run (e.g. by LoraPacketTracker) pins its slot for
+ * good, so the scenarios do not enable packet tracking. In steady state every uplink
+ * reuses a slot freed by the previous cycle, so no Packet object is
+ * allocated; Buffer data already comes from the ns-3 free list. Every slot
+ * growth is counted so the run summary can show it.
+ */
+#ifndef TARAKO_ARENA_H
+#define TARAKO_ARENA_H
+
+#include "ns3/packet.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace tarako {
+
+class PacketArena
+{
+public:
+    PacketArena()
+        : m_head(0),
+          m_in_flight_num(0),
+          m_growth(0),
+          m_acquired(0)
+    {
+    }
+
+    ns3::Ptr<ns3::Packet> Acquire(const uint8_t* buffer, uint32_t size)
+    {
+        m_acquired++;
+        if (m_free.empty()) Reclaim();
+        size_t slot;
+        if (!m_free.empty()) {
+            slot = m_free.back();
+            m_free.pop_back();
+            *m_slots[slot] = ns3::Packet(buffer, size);
+        } else {
+            slot = m_slots.size();
+            m_growth++;
+            m_slots.push_back(ns3::Create<ns3::Packet>(buffer, size));
+            m_free.reserve(m_slots.capacity());
+        }
+        PushInFlight(slot);
+        return m_slots[slot];
+    }
+
+    // Make room for the expected number of packets in flight up front
+    void Reserve(size_t slot_num)
+    {
+        m_slots.reserve(slot_num);
+        m_free.reserve(slot_num);
+        if (m_in_flight_num == 0 && m_in_flight.size() < slot_num) {
+            m_in_flight.assign(slot_num, 0);
+            m_head = 0;
+        }
+    }
+
+    uint64_t GetGrowth() const { return m_growth; }
+    uint64_t GetAcquired() const { return m_acquired; }
+    size_t GetSize() const { return m_slots.size(); }
+
+private:
+    // Visit every slot in flight once: released ones to the free list, held ones back in the ring
+    void Reclaim()
+    {
+        for (size_t n = m_in_flight_num; n > 0; n--) {
+            const size_t slot = m_in_flight[m_head];
+            m_head = (m_head + 1) % m_in_flight.size();
+            m_in_flight_num--;
+            if (m_slots[slot]->GetReferenceCount() == 1) m_free.push_back(slot);
+            else PushInFlight(slot);
+        }
+    }
+
+    void PushInFlight(size_t slot)
+    {
+        if (m_in_flight_num == m_in_flight.size()) {
+            // Full ring: unroll into a larger one, oldest first
+            std::vector<size_t> ring(std::max<size_t>(2 * m_in_flight.size(), 16));
+            for (size_t i = 0; i < m_in_flight_num; i++) ring[i] = m_in_flight[(m_head + i) % m_in_flight.size()];
+            m_in_flight.swap(ring);
+            m_head = 0;
+        }
+        m_in_flight[(m_head + m_in_flight_num) % m_in_flight.size()] = slot;
+        m_in_flight_num++;
+    }
+
+    std::vector<ns3::Ptr<ns3::Packet>> m_slots;
+    std::vector<size_t> m_free;         // released slots, reused LIFO
+    std::vector<size_t> m_in_flight;    // ring of handed-out slots in send order
+    size_t m_head;
+    size_t m_in_flight_num;
+    uint64_t m_growth;
+    uint64_t m_acquired;
+};
+
+} // namespace tarako
+
+#endif // TARAKO_ARENA_H
@@ -0,0 +1,737 @@
+/*
+ * Scenario engine shared by only_lorawan and heterogeneous_wireless.
+ *
+ * The engine owns the runtime callbacks (activation, BLE indication, network
+ * server reception). Roles are resolved once in Setup(); every node is then
+ * scheduled on the callback of its role, so the hot path only runs the code of
+ * the policy combination the binary was compiled with (see tarako_policy.h).
+ *
+ * The engine's own pools do not grow in steady state: activation and flush
+ * events are created once per node and rescheduled, payloads are encoded into
+ * one engine buffer and packets come from a PacketArena (tarako_arena.h).
+ * What the ns-3 stack allocates below Send is not covered; scenarios measure
+ * real heap allocations with tarako_heap_counter.h.
+ *
+ * BLE routes are computed once in Setup() from node positions and the LrWpan
+ * link budget: for every leader (every group mate when rotating), members in
+ * direct range get a one-hop route; the rest are found by a breadth-first
+ * search from the leader, bounded by Routing::MAX_HOPS, and the route is
+ * stored only on the nodes along each member's path. Members without a route
+ * report over LoRaWAN instead.
+ *
+ * With Sensor = TraceFill, fill levels come from a FillTrace instead of the
+ * random increment. Every node holds one cursor into the trace and one fill
+ * event, rescheduled to the next record of its station when it fires.
+ *
+ * The group protocol is the engine's own. The module's OnActivateNodeForGroup,
+ * DataIndication and OnPacketRecievedAtNetworkServerForGroup are not in this
+ * tree and are not reproduced, so its parameters are engine choices, not
+ * values taken from the module:
+ *   - collect window 5 s (m_collect_window): a leader sends the group uplink
+ *     5 s after its own activation, long enough for the members' BLE frames
+ *     (same activate_time and interval) including MAC retries
+ *   - payload: ConditionCodec, 3 bytes per report (BLE short address and
+ *     condition), one entry per reporter, so a group uplink stays far below
+ *     MAX_PAYLOAD_SIZE
+ *   - inbox: the leader buffers the entries received in the window and clears
+ *     them after the uplink; nothing is carried over to the next interval
+ * Uplink counts, payload sizes and energy are therefore not comparable with
+ * logs written by the module callbacks.
+ */
+#ifndef TARAKO_ENGINE_H
+#define TARAKO_ENGINE_H
+
+#include "tarako_policy.h"
+#include "tarako_arena.h"
+#include "tarako_interference.h"
+#include "tarako_fill_trace.h"
+
+#include "ns3/util.h"
+#include "ns3/node_payload.h"
+#include "ns3/group_node.h"
+
+#include "ns3/simulator.h"
+#include "ns3/make-event.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/lora-net-device.h"
+#include "ns3/lora-frame-header.h"
+#include "ns3/lorawan-mac-header.h"
+#include "ns3/end-device-lorawan-mac.h"
+#include <ns3/lr-wpan-net-device.h>
+#include <ns3/lr-wpan-mac.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tarako {
+
+// Path the node's own report took in its last activation
+enum class ReportPath: uint8_t
+{
+    NONE     = 0,   // not activated yet
+    LORAWAN  = 1,   // solo uplink
+    LEAD     = 2,   // collected the group and sent its uplink
+    BLE      = 3,   // one hop to the leader
+    RELAY    = 4,   // two or more hops to the leader
+    FALLBACK = 5    // no route to the leader, solo uplink instead
+};
+
+// Role played in the last activation, watched by LifetimeEstimator
+struct NodeRole
+{
+    uint16_t leader;    // BLE short address, own address when leading or solo
+    ReportPath path;
+};
+
+template <class Grouping, class Pairing, class Equalization, class Codec, class Trigger,
+          class Routing = policy::DirectRoute, class Sensor = policy::RandomFill>
+class TarakoEngine
+{
+public:
+    typedef Grouping     grouping_policy;
+    typedef Pairing      pairing_policy;
+    typedef Equalization equalization_policy;
+    typedef Codec        codec_policy;
+    typedef Trigger      trigger_policy;
+    typedef Routing      routing_policy;
+    typedef Sensor       sensor_policy;
+    typedef TarakoEngine<Grouping, Pairing, Equalization, Codec, Trigger, Routing, Sensor> Engine;
+    struct NodeRuntime;
+    typedef void (Engine::*Activation)(NodeRuntime*);
+    static_assert(Codec::addressed || !Grouping::enabled, "a group uplink needs a codec that names each reporter");
+
+    struct Route
+    {
+        NodeRuntime* next_hop;
+        int hops;
+    };
+
+    struct NodeRuntime
+    {
+        TarakoNodeData* data;
+        Engine* engine;
+        ns3::Mac16Address ble_addr;
+        uint16_t ble_short_addr;
+        std::vector<NodeRuntime*> group;        // sorted by id, including this node
+        size_t self_index;
+        size_t first_leader;
+        uint32_t cycle;
+        Activation activate;
+        ns3::Ptr<ns3::EventImpl> activation_event;  // rescheduled every interval
+        ns3::Ptr<ns3::EventImpl> flush_event;
+        ns3::Ptr<ns3::EventImpl> fill_event;        // next record of the station (TraceFill)
+        uint64_t fill_cursor;
+        policy::GarbageBoxCondition last_condition;
+        NodeRole role;
+        std::vector<typename Codec::Entry> inbox;   // reserved for the whole group in Setup()
+        std::unordered_map<uint16_t, Route> routes; // destination BLE address -> next hop
+        ns3::Ptr<ns3::lorawan::EndDeviceLorawanMac> lora_mac;
+        // --- Statistics --- //
+        uint32_t generated_reports;
+        uint32_t delivered_reports;
+        uint32_t lora_sent_packets;
+        uint32_t ble_sent_packets;
+        uint32_t ble_received_packets;
+        uint32_t ble_forwarded_packets;     // frames relayed for other members
+        uint32_t ble_failed_packets;        // MCPS-DATA.confirm other than SUCCESS
+        uint32_t relayed_reports;           // own reports that needed two or more hops
+        uint32_t fallback_reports;          // own reports sent over LoRaWAN for lack of a route
+        int64_t lora_airtime;               // [ns]
+        int64_t relay_saved_airtime;        // [ns] solo uplinks replaced by relayed reports, less the
+                                            // longer group uplinks that carried them (booked on the leader)
+        std::vector<std::pair<uint64_t, uint32_t>> received_frames; // (packet uid, fcnt) at NS, if kept
+    };
+
+    TarakoEngine()
+        : m_collect_window(ns3::Seconds(5)),
+          m_inbox_growth(0),
+          m_warmup_growth(0),
+          m_unreachable_members(0),
+          m_trace(nullptr),
+          m_trace_start(0),
+          m_fill_records(0),
+          m_untraced_nodes(0),
+          m_keep_frames(false)
+    {
+    }
+
+    /*
+     * Resolve groups and roles for all nodes. Fills group_node_addrs,
+     * leader_node_addr and current_status of TarakoNodeData for logging.
+     */
+    void Setup(std::unordered_map<int, TarakoNodeData>& nodes, const std::string& pair_file)
+    {
+        // Created here, after CommandLine parsing, so --RngSeed/--RngRun apply
+        m_fill = ns3::CreateObject<ns3::UniformRandomVariable> ();
+        m_unreachable_members = 0;
+        m_runtimes.clear();
+        m_runtimes.reserve(nodes.size());
+        for (auto itr = nodes.begin(); itr != nodes.end(); ++itr) {
+            NodeRuntime runtime;
+            runtime.data              = &itr->second;
+            runtime.engine            = this;
+            runtime.ble_addr          = ns3::Mac16Address(itr->second.ble_network_addr.c_str());
+            runtime.ble_short_addr    = ToShortAddr(runtime.ble_addr);
+            runtime.self_index        = 0;
+            runtime.first_leader      = 0;
+            runtime.cycle             = 0;
+            runtime.fill_cursor       = FillTrace::END;
+            runtime.activate          = &Engine::ActivateSolo;
+            runtime.last_condition    = policy::GarbageBoxCondition::EMPTY;
+            runtime.role.leader       = runtime.ble_short_addr;
+            runtime.role.path         = ReportPath::NONE;
+            runtime.generated_reports    = 0;
+            runtime.delivered_reports    = 0;
+            runtime.lora_sent_packets    = 0;
+            runtime.ble_sent_packets     = 0;
+            runtime.ble_received_packets = 0;
+            runtime.ble_forwarded_packets = 0;
+            runtime.ble_failed_packets   = 0;
+            runtime.relayed_reports      = 0;
+            runtime.fallback_reports     = 0;
+            runtime.lora_airtime         = 0;
+            runtime.relay_saved_airtime  = 0;
+            m_runtimes.push_back(runtime);
+        }
+        std::sort(m_runtimes.begin(), m_runtimes.end(),
+            [](const NodeRuntime& a, const NodeRuntime& b) { return a.data->id < b.data->id; });
+        m_by_lora_addr.clear();
+        m_by_ble_addr.clear();
+        for (auto& runtime: m_runtimes) {
+            m_by_lora_addr[runtime.data->lora_network_addr] = &runtime;
+            m_by_ble_addr[runtime.ble_short_addr]           = &runtime;
+        }
+        if (!Grouping::enabled) {
+            for (auto& runtime: m_runtimes) runtime.data->current_status = TarakoNodeStatus::only_lorawan;
+            return;
+        }
+        for (auto& runtime: m_runtimes) {
+            TarakoNodeData* node = runtime.data;
+            const std::vector<std::string> pair_organizes = Pairing::Load(pair_file, node->belong_to);
+            node->group_node_addrs.clear();
+            runtime.group.clear();
+            for (auto& other: m_runtimes) {
+                if (&other == &runtime) {
+                    runtime.group.push_back(&other);
+                    continue;
+                }
+                if (Grouping::IsGroupMate(node->belong_to, other.data->belong_to, pair_organizes)) {
+                    node->group_node_addrs.push_back({other.data->lora_network_addr, other.data->ble_network_addr});
+                    runtime.group.push_back(&other);
+                }
+            }
+            if (node->group_node_addrs.empty()) {
+                runtime.group.clear();
+                node->current_status = TarakoNodeStatus::only_lorawan;
+                continue;
+            }
+            node->leader_node_addr = TarakoUtil::GetFirstLeader(node->group_node_addrs, node->lora_network_addr, node->ble_network_addr);
+            for (size_t i = 0; i < runtime.group.size(); i++) {
+                if (runtime.group[i] == &runtime) runtime.self_index = i;
+                if (runtime.group[i]->data->ble_network_addr == node->leader_node_addr) runtime.first_leader = i;
+            }
+            runtime.inbox.reserve(runtime.group.size());
+            const bool is_leader = runtime.self_index == runtime.first_leader;
+            node->current_status = is_leader ? TarakoNodeStatus::group_leader : TarakoNodeStatus::group_member;
+            if (Equalization::rotates) runtime.activate = &Engine::ActivateRotating;
+            else runtime.activate = is_leader ? &Engine::ActivateLeader : &Engine::ActivateMember;
+        }
+        BuildRoutes();
+        // A fixed leader out of reach means every report of the member would be lost
+        for (auto& runtime: m_runtimes) {
+            if (runtime.data->current_status != TarakoNodeStatus::group_member || Equalization::rotates) continue;
+            if (runtime.routes.count(runtime.group[runtime.first_leader]->ble_short_addr)) continue;
+            runtime.data->group_node_addrs.clear();
+            runtime.data->current_status = TarakoNodeStatus::only_lorawan;
+            runtime.group.clear();
+            runtime.activate = &Engine::ActivateSolo;
+            m_unreachable_members++;
+        }
+    }
+
+    /*
+     * Replay fill levels from trace (TraceFill only), starting start seconds
+     * after the trace epoch at simulation time 0. Call before Start().
+     */
+    void SetFillTrace(const FillTrace* trace, uint32_t start)
+    {
+        m_trace       = trace;
+        m_trace_start = start;
+    }
+
+    /*
+     * Keep (packet uid, fcnt) of every frame received at the network server in
+     * NodeRuntime::received_frames. Off by default: the list grows with the run.
+     */
+    void SetKeepReceivedFrames(bool keep)
+    {
+        m_keep_frames = keep;
+    }
+
+    // Connect the BLE indication and schedule the first activation of every node
+    void Start()
+    {
+        // One packet in flight per node, plus headroom for MAC retransmissions
+        m_arena.Reserve(2 * m_runtimes.size());
+        for (auto& runtime: m_runtimes) {
+            if (Grouping::enabled) {
+                runtime.data->lr_wpan_net_device->GetMac()->SetMcpsDataIndicationCallback(
+                    ns3::MakeBoundCallback(&Engine::DataIndication, &runtime)
+                );
+                runtime.data->lr_wpan_net_device->GetMac()->SetMcpsDataConfirmCallback(
+                    ns3::MakeBoundCallback(&Engine::DataConfirm, &runtime)
+                );
+            }
+            runtime.lora_mac = runtime.data->lora_net_device->GetMac()->template GetObject<ns3::lorawan::EndDeviceLorawanMac>();
+            runtime.activation_event = ns3::Ptr<ns3::EventImpl>(ns3::MakeEvent(runtime.activate, this, &runtime), false);
+            runtime.flush_event      = ns3::Ptr<ns3::EventImpl>(ns3::MakeEvent(&Engine::Flush, this, &runtime), false);
+            ns3::Simulator::Schedule(runtime.data->activate_time, runtime.activation_event);
+            if (Sensor::replays) StartFill(&runtime);
+        }
+    }
+
+    // NetworkServer "ReceivedPacket" trace
+    void OnPacketReceivedAtNetworkServer(ns3::Ptr<const ns3::Packet> packet)
+    {
+        ns3::lorawan::LorawanMacHeader mHdr;
+        ns3::lorawan::LoraFrameHeader fHdr;
+        ns3::Ptr<ns3::Packet> copy = packet->Copy();
+        copy->RemoveHeader(mHdr);
+        copy->RemoveHeader(fHdr);
+        auto sender = m_by_lora_addr.find(fHdr.GetAddress().GetNwkAddr());
+        if (sender == m_by_lora_addr.end()) return;
+        if (m_keep_frames) {
+            sender->second->received_frames.push_back(std::make_pair(packet->GetUid(), (uint32_t)fHdr.GetFCnt()));
+        }
+        uint8_t buffer[MAX_PAYLOAD_SIZE];
+        typename Codec::Entry entries[MAX_PAYLOAD_SIZE / Codec::ENTRY_SIZE];
+        const size_t size = std::min((size_t)copy->GetSize(), sizeof(buffer));
+        copy->CopyData(buffer, size);
+        const size_t num = Codec::Decode(buffer, size, entries, sizeof(entries) / sizeof(entries[0]));
+        if (!Codec::addressed) {
+            sender->second->delivered_reports += num;
+            return;
+        }
+        for (size_t i = 0; i < num; i++) {
+            auto reporter = m_by_ble_addr.find(entries[i].ble_addr);
+            if (reporter != m_by_ble_addr.end()) reporter->second->delivered_reports++;
+        }
+    }
+
+    const std::vector<NodeRuntime>& GetRuntimes() const { return m_runtimes; }
+
+    // Pool growth on the send paths: new arena slots and inbox reallocations.
+    // Other heap allocations (ns-3 stack, events) are not counted; see tarako_heap_counter.h
+    uint64_t GetPoolGrowth() const { return m_arena.GetGrowth() + m_inbox_growth; }
+
+    // LoRaWAN airtime of all uplinks, and of the solo uplinks the relay avoided [s]
+    double GetLoraAirtime() const
+    {
+        int64_t airtime = 0;
+        for (auto& runtime: m_runtimes) airtime += runtime.lora_airtime;
+        return airtime * 1e-9;
+    }
+
+    double GetRelaySavedAirtime() const
+    {
+        int64_t airtime = 0;
+        for (auto& runtime: m_runtimes) airtime += runtime.relay_saved_airtime;
+        return airtime * 1e-9;
+    }
+
+    void PrintSummary(std::ostream& os) const
+    {
+        uint64_t lora = 0, ble = 0, forwarded = 0, failed = 0, relayed = 0, fallback = 0;
+        for (auto& runtime: m_runtimes) {
+            lora      += runtime.lora_sent_packets;
+            ble       += runtime.ble_sent_packets;
+            forwarded += runtime.ble_forwarded_packets;
+            failed    += runtime.ble_failed_packets;
+            relayed   += runtime.relayed_reports;
+            fallback  += runtime.fallback_reports;
+        }
+        const uint64_t steady = GetPoolGrowth() - m_warmup_growth;
+        os << "[ENGINE] uplinks: " << lora << " LoRa, " << ble << " BLE" << std::endl;
+        os << "[ENGINE] send path pool growth: " << GetPoolGrowth();
+        os << " (after first interval: " << steady << ", ";
+        os << (lora + ble > 0 ? (double)steady / (lora + ble) : 0.0) << " per uplink)";
+        os << ", arena slots: " << m_arena.GetSize() << std::endl;
+        if (Sensor::replays) {
+            os << "[ENGINE] fill trace: " << m_fill_records << " records replayed, ";
+            os << m_untraced_nodes << " nodes without trace" << std::endl;
+        }
+        if (!Grouping::enabled) return;
+        os << "[ENGINE] BLE routing: up to " << Routing::MAX_HOPS << " hops, ";
+        os << m_unreachable_members << " members without route, " << relayed << " relayed reports, ";
+        os << forwarded << " forwards, " << failed << " failed hops, " << fallback << " LoRaWAN fallbacks" << std::endl;
+        os << "[ENGINE] LoRaWAN airtime: " << GetLoraAirtime() << " s (single-hop: ";
+        os << GetLoraAirtime() + GetRelaySavedAirtime() << " s)" << std::endl;
+    }
+
+    NodeRuntime* GetRuntime(uint32_t lora_network_addr)
+    {
+        auto found = m_by_lora_addr.find(lora_network_addr);
+        return found == m_by_lora_addr.end() ? nullptr : found->second;
+    }
+
+private:
+    static const size_t MAX_PAYLOAD_SIZE = 222; // EU868 DR5 without FOpts
+    static const size_t MAX_ROUTE_HEADER = 2;
+    static const int LORA_FRAME_OVERHEAD = 9;   // MHDR, FHDR without FOpts, FPort
+
+    static uint16_t ToShortAddr(ns3::Mac16Address addr)
+    {
+        uint8_t buffer[2];
+        addr.CopyTo(buffer);
+        return (uint16_t)((buffer[0] << 8) | buffer[1]);
+    }
+
+    // --- BLE routes: BFS from each leader toward the members reporting to it --- //
+    void BuildRoutes()
+    {
+        const size_t node_num = m_runtimes.size();
+        // Members per possible leader: the fixed leader, or every group mate when rotating
+        std::vector<std::vector<size_t>> members(node_num);
+        for (size_t i = 0; i < node_num; i++) {
+            NodeRuntime& runtime = m_runtimes[i];
+            if (runtime.group.empty()) continue;
+            if (Equalization::rotates) {
+                for (NodeRuntime* mate: runtime.group) {
+                    if (mate != &runtime) members[IndexOf(mate)].push_back(i);
+                }
+            } else if (runtime.data->current_status == TarakoNodeStatus::group_member) {
+                members[IndexOf(runtime.group[runtime.first_leader])].push_back(i);
+            }
+        }
+        const double range = policy::BleLinkBudget::GetRange();
+        std::map<std::pair<int64_t, int64_t>, std::vector<size_t>> grid;
+        for (size_t i = 0; i < node_num; i++) grid[GridCell(m_runtimes[i].data->position, range)].push_back(i);
+        // BFS state, valid where visited equals the current stamp (no reset per search)
+        std::vector<uint32_t> visited(node_num, 0);
+        std::vector<size_t> parent(node_num);
+        std::vector<int> depth(node_num);
+        std::vector<size_t> frontier, next;
+        uint32_t stamp = 0;
+        for (size_t d = 0; d < node_num; d++) {
+            if (members[d].empty()) continue;
+            NodeRuntime& leader = m_runtimes[d];
+            const ns3::Vector& origin = leader.data->position;
+            // Members in direct range need no search
+            size_t remaining = 0;
+            for (size_t m: members[d]) {
+                if (ns3::CalculateDistance(origin, m_runtimes[m].data->position) <= range) {
+                    m_runtimes[m].routes[leader.ble_short_addr] = {&leader, 1};
+                } else {
+                    remaining++;
+                }
+            }
+            if (remaining == 0 || Routing::MAX_HOPS < 2) continue;
+            stamp++;
+            for (size_t m: members[d]) {
+                if (!m_runtimes[m].routes.count(leader.ble_short_addr)) visited[m] = stamp;
+            }
+            // Unreached members are marked stamp, everything else seen is stamp + 1
+            const uint32_t seen = ++stamp;
+            visited[d] = seen;
+            depth[d]   = 0;
+            frontier.assign(1, d);
+            for (int hops = 1; hops <= Routing::MAX_HOPS && !frontier.empty() && remaining > 0; hops++) {
+                next.clear();
+                for (size_t u: frontier) {
+                    const ns3::Vector& pos = m_runtimes[u].data->position;
+                    const std::pair<int64_t, int64_t> cell = GridCell(pos, range);
+                    for (int64_t dx = -1; dx <= 1; dx++) {
+                        for (int64_t dy = -1; dy <= 1; dy++) {
+                            auto found = grid.find(std::make_pair(cell.first + dx, cell.second + dy));
+                            if (found == grid.end()) continue;
+                            for (size_t v: found->second) {
+                                if (visited[v] == seen) continue;
+                                if (ns3::CalculateDistance(pos, m_runtimes[v].data->position) > range) continue;
+                                const bool target = visited[v] == seen - 1;
+                                visited[v] = seen;
+                                parent[v]  = u;
+                                depth[v]   = hops;
+                                next.push_back(v);
+                                if (target) {
+                                    AddRoute(d, v, parent, depth);
+                                    remaining--;
+                                }
+                            }
+                        }
+                    }
+                }
+                frontier.swap(next);
+            }
+        }
+    }
+
+    // Store the route to leader d on every node of the path from member m
+    void AddRoute(size_t d, size_t m, const std::vector<size_t>& parent, const std::vector<int>& depth)
+    {
+        const uint16_t destination = m_runtimes[d].ble_short_addr;
+        for (size_t v = m; v != d; v = parent[v]) {
+            auto inserted = m_runtimes[v].routes.insert(std::make_pair(destination, Route{&m_runtimes[parent[v]], depth[v]}));
+            if (!inserted.second) break;    // rest of the path already stored by another member
+        }
+    }
+
+    size_t IndexOf(const NodeRuntime* runtime) const { return runtime - m_runtimes.data(); }
+
+    static std::pair<int64_t, int64_t> GridCell(const ns3::Vector& pos, double range)
+    {
+        return std::make_pair((int64_t)std::floor(pos.x / range), (int64_t)std::floor(pos.y / range));
+    }
+
+    // --- Activation: one callback per role --- //
+    void ActivateSolo(NodeRuntime* n)
+    {
+        n->role.leader = n->ble_short_addr;
+        n->role.path   = ReportPath::LORAWAN;
+        const policy::GarbageBoxCondition c = ReadSensor(n);
+        if (Trigger::ShouldReport(n->last_condition, c)) {
+            typename Codec::Entry entry = {n->ble_short_addr, c};
+            n->generated_reports++;
+            SendLoRa(n, &entry, 1);
+        }
+        n->last_condition = c;
+        n->cycle++;
+        ns3::Simulator::Schedule(n->data->conn_interval, n->activation_event);
+    }
+
+    void ActivateLeader(NodeRuntime* n)
+    {
+        Lead(n);
+        n->cycle++;
+        ns3::Simulator::Schedule(n->data->conn_interval, n->activation_event);
+    }
+
+    void ActivateMember(NodeRuntime* n)
+    {
+        Report(n, n->group[n->first_leader]);
+        n->cycle++;
+        ns3::Simulator::Schedule(n->data->conn_interval, n->activation_event);
+    }
+
+    void ActivateRotating(NodeRuntime* n)
+    {
+        const size_t leader = Equalization::LeaderIndex(n->first_leader, n->cycle, n->group.size());
+        if (leader == n->self_index) Lead(n);
+        else Report(n, n->group[leader]);
+        n->cycle++;
+        ns3::Simulator::Schedule(n->data->conn_interval, n->activation_event);
+    }
+
+    // --- Role actions --- //
+    void Lead(NodeRuntime* n)
+    {
+        n->role.leader = n->ble_short_addr;
+        n->role.path   = ReportPath::LEAD;
+        const policy::GarbageBoxCondition c = ReadSensor(n);
+        if (Trigger::ShouldReport(n->last_condition, c)) {
+            typename Codec::Entry entry = {n->ble_short_addr, c};
+            n->generated_reports++;
+            n->inbox.push_back(entry);
+        }
+        n->last_condition = c;
+        ns3::Simulator::Schedule(m_collect_window, n->flush_event);
+    }
+
+    void Flush(NodeRuntime* n)
+    {
+        if (n->inbox.empty()) return;
+        const size_t num = std::min(n->inbox.size(), MAX_PAYLOAD_SIZE / Codec::ENTRY_SIZE);
+        if (Routing::MAX_HOPS > 1) {
+            // Relayed entries make this uplink longer; that part of the saving is given back
+            size_t relayed = 0;
+            for (size_t i = 0; i < num; i++) {
+                auto reporter = m_by_ble_addr.find(n->inbox[i].ble_addr);
+                if (reporter != m_by_ble_addr.end() && reporter->second->role.path == ReportPath::RELAY) relayed++;
+            }
+            if (relayed > 0) {
+                n->relay_saved_airtime -= GetAirtime(n, num * Codec::ENTRY_SIZE)
+                                        - GetAirtime(n, (num - relayed) * Codec::ENTRY_SIZE);
+            }
+        }
+        SendLoRa(n, n->inbox.data(), num);
+        n->inbox.clear();
+    }
+
+    void Report(NodeRuntime* n, NodeRuntime* leader)
+    {
+        auto route = n->routes.find(leader->ble_short_addr);
+        n->role.leader = leader->ble_short_addr;
+        if (route == n->routes.end()) n->role.path = ReportPath::FALLBACK;
+        else n->role.path = route->second.hops > 1 ? ReportPath::RELAY : ReportPath::BLE;
+        const policy::GarbageBoxCondition c = ReadSensor(n);
+        if (Trigger::ShouldReport(n->last_condition, c)) {
+            typename Codec::Entry entry = {n->ble_short_addr, c};
+            n->generated_reports++;
+            if (route == n->routes.end()) {
+                n->fallback_reports++;
+                SendLoRa(n, &entry, 1);
+            } else {
+                // Without the relay this report would have been a solo uplink
+                if (route->second.hops > 1) {
+                    n->relayed_reports++;
+                    n->relay_saved_airtime += GetAirtime(n, Codec::ENTRY_SIZE);
+                }
+                SendBle(n, route->second.next_hop, leader->ble_short_addr, &entry, 1);
+            }
+        }
+        n->last_condition = c;
+    }
+
+    policy::GarbageBoxCondition ReadSensor(NodeRuntime* n)
+    {
+        if (Sensor::replays) return policy::JudgeGarbageBoxLevel(n->data->sensor.current_volume);
+        return policy::JudgeGarbageBoxCondition(n->data->sensor.current_volume, m_fill->GetInteger(1, 5));
+    }
+
+    // --- Fill trace replay: one pending fill event per node --- //
+    void StartFill(NodeRuntime* n)
+    {
+        n->fill_cursor = m_trace ? m_trace->Find(n->data->belong_to) : FillTrace::END;
+        if (n->fill_cursor == FillTrace::END) {
+            m_untraced_nodes++;
+            return;
+        }
+        // Records before the replay window only set the initial level
+        while (n->fill_cursor != FillTrace::END) {
+            const FillTrace::Record record = m_trace->Get(n->fill_cursor);
+            if (record.time >= m_trace_start) break;
+            n->data->sensor.current_volume = record.volume;
+            n->fill_cursor = m_trace->Next(n->fill_cursor);
+        }
+        n->fill_event = ns3::Ptr<ns3::EventImpl>(ns3::MakeEvent(&Engine::ApplyFill, this, n), false);
+        ScheduleFill(n);
+    }
+
+    void ScheduleFill(NodeRuntime* n)
+    {
+        if (n->fill_cursor == FillTrace::END) return;
+        const FillTrace::Record record = m_trace->Get(n->fill_cursor);
+        const ns3::Time at = ns3::Seconds(record.time - m_trace_start);
+        ns3::Simulator::Schedule(at - ns3::Simulator::Now(), n->fill_event);
+    }
+
+    void ApplyFill(NodeRuntime* n)
+    {
+        n->data->sensor.current_volume = m_trace->Get(n->fill_cursor).volume;
+        n->fill_cursor = m_trace->Next(n->fill_cursor);
+        m_fill_records++;
+        ScheduleFill(n);
+    }
+
+    void SendLoRa(NodeRuntime* n, const typename Codec::Entry* entries, size_t num)
+    {
+        num = std::min(num, MAX_PAYLOAD_SIZE / Codec::ENTRY_SIZE);
+        const size_t size = Codec::Encode(entries, num, m_payload);
+        n->lora_sent_packets++;
+        n->lora_airtime += GetAirtime(n, size);
+        n->data->lora_net_device->Send(Acquire(n, size));
+    }
+
+    // Airtime [ns] of an uplink at the current data rate of the node (ADR may change it)
+    int64_t GetAirtime(NodeRuntime* n, size_t payload_size) const
+    {
+        const uint8_t sf = n->lora_mac->GetSfFromDataRate(n->lora_mac->GetDataRate());
+        return GetLoraOnAirTime(sf, (int)payload_size + LORA_FRAME_OVERHEAD);
+    }
+
+    void SendBle(NodeRuntime* n, NodeRuntime* next_hop, uint16_t destination,
+                 const typename Codec::Entry* entries, size_t num)
+    {
+        num = std::min(num, (MAX_PAYLOAD_SIZE - MAX_ROUTE_HEADER) / Codec::ENTRY_SIZE);
+        const size_t header = Routing::EncodeHeader(destination, m_payload);
+        const size_t size   = header + Codec::Encode(entries, num, m_payload + header);
+        Transmit(n, next_hop, size);
+    }
+
+    // Relay a frame already in m_payload one hop closer to its destination
+    void Forward(NodeRuntime* n, uint16_t destination, const uint8_t* frame, size_t size)
+    {
+        auto route = n->routes.find(destination);
+        if (route == n->routes.end()) {
+            n->ble_failed_packets++;
+            return;
+        }
+        std::memcpy(m_payload, frame, size);
+        n->ble_forwarded_packets++;
+        Transmit(n, route->second.next_hop, size);
+    }
+
+    void Transmit(NodeRuntime* n, NodeRuntime* next_hop, size_t size)
+    {
+        ns3::McpsDataRequestParams params;
+        params.m_srcAddrMode = ns3::SHORT_ADDR;
+        params.m_dstAddrMode = ns3::SHORT_ADDR;
+        params.m_dstPanId    = n->data->lr_wpan_net_device->GetMac()->GetPanId();
+        params.m_dstAddr     = next_hop->ble_addr;
+        params.m_msduHandle  = 0;
+        params.m_txOptions   = ns3::TX_OPTION_ACK;
+        n->ble_sent_packets++;
+        n->data->lr_wpan_net_device->GetMac()->McpsDataRequest(params, Acquire(n, size));
+    }
+
+    ns3::Ptr<ns3::Packet> Acquire(NodeRuntime* n, size_t size)
+    {
+        const uint64_t before = m_arena.GetGrowth();
+        ns3::Ptr<ns3::Packet> packet = m_arena.Acquire(m_payload, size);
+        if (n->cycle == 0) m_warmup_growth += m_arena.GetGrowth() - before;
+        return packet;
+    }
+
+    // --- BLE reception at the current leader or at a relay --- //
+    static void DataIndication(NodeRuntime* n, ns3::McpsDataIndicationParams params, ns3::Ptr<ns3::Packet> packet)
+    {
+        uint8_t buffer[MAX_PAYLOAD_SIZE];
+        typename Codec::Entry entries[MAX_PAYLOAD_SIZE / Codec::ENTRY_SIZE];
+        const size_t size = std::min((size_t)packet->GetSize(), sizeof(buffer));
+        packet->CopyData(buffer, size);
+        n->ble_received_packets++;
+        uint16_t destination;
+        const size_t header = Routing::DecodeHeader(buffer, size, n->ble_short_addr, &destination);
+        if (destination != n->ble_short_addr) {
+            n->engine->Forward(n, destination, buffer, size);
+            return;
+        }
+        const size_t num = Codec::Decode(buffer + header, size - header, entries, sizeof(entries) / sizeof(entries[0]));
+        if (n->inbox.size() + num > n->inbox.capacity()) {
+            n->engine->m_inbox_growth++;
+            if (n->cycle == 0) n->engine->m_warmup_growth++;
+        }
+        n->inbox.insert(n->inbox.end(), entries, entries + num);
+    }
+
+    static void DataConfirm(NodeRuntime* n, ns3::McpsDataConfirmParams params)
+    {
+        if (params.m_status != ns3::IEEE_802_15_4_SUCCESS) n->ble_failed_packets++;
+    }
+
+    ns3::Time m_collect_window;
+    ns3::Ptr<ns3::UniformRandomVariable> m_fill;    // fill level increment per interval, 1-5 L
+    uint8_t m_payload[MAX_PAYLOAD_SIZE];            // encode buffer shared by all send paths
+    PacketArena m_arena;
+    uint64_t m_inbox_growth;
+    uint64_t m_warmup_growth;
+    uint64_t m_unreachable_members;
+    const FillTrace* m_trace;
+    uint32_t m_trace_start;                         // [s] since trace epoch at simulation time 0
+    uint64_t m_fill_records;
+    uint64_t m_untraced_nodes;
+    bool m_keep_frames;
+    std::vector<NodeRuntime> m_runtimes;
+    std::unordered_map<uint32_t, NodeRuntime*> m_by_lora_addr;
+    std::unordered_map<uint16_t, NodeRuntime*> m_by_ble_addr;
+};
+
+} // namespace tarako
+
+#endif // TARAKO_ENGINE_H
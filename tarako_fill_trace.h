@@ -0,0 +1,187 @@
+/*
+ * Memory-mapped reader of recorded garbage box fill levels.
+ *
+ * The trace is written by fill_trace.py from per-station fill logs. Records are
+ * sorted by time over all stations and every record links to the next record
+ * of the same station, so a node only keeps a cursor (record index) and walks
+ * its own station forward. Nothing is loaded up front: pages are mapped on
+ * demand and, since the replay advances through the file in time order, the
+ * kernel can drop them again behind the replay. Memory stays O(nodes)
+ * however long the trace is.
+ *
+ * That bound covers the replay, not the whole run: with --series,
+ * heterogeneous_wireless keeps one row per interval, and an engine with
+ * SetKeepReceivedFrames(true) keeps one entry per received frame. Both grow
+ * with simulated time.
+ *
+ * Layout (little endian):
+ *   header   32 bytes  magic "TKFT", version, record size, station num,
+ *                      record num, epoch [unix s], reserved
+ *   stations 16 bytes  id (8 bytes, NUL padded), first record index;
+ *                      sorted by id
+ *   records  12 bytes  time [s since epoch], records to the next one of the
+ *                      same station (0: last), station index, volume [L],
+ *                      reserved
+ * No ns-3 dependency.
+ */
+#ifndef TARAKO_FILL_TRACE_H
+#define TARAKO_FILL_TRACE_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace tarako {
+
+class FillTrace
+{
+public:
+    static const uint64_t END           = UINT64_MAX;
+    static const uint16_t VERSION       = 1;
+    static const size_t HEADER_SIZE     = 32;
+    static const size_t STATION_SIZE    = 16;
+    static const size_t STATION_ID_SIZE = 8;
+    static const size_t RECORD_SIZE     = 12;
+
+    struct Record
+    {
+        uint32_t time;      // [s] since epoch
+        uint32_t next;      // records to the next one of the same station, 0 if last
+        uint16_t station;
+        uint8_t volume;     // [L]
+    };
+
+    FillTrace()
+        : m_base(nullptr),
+          m_size(0),
+          m_station_num(0),
+          m_record_num(0),
+          m_epoch(0)
+    {
+    }
+
+    ~FillTrace() { Close(); }
+
+    // Map the trace read-only; false if the file is missing or not a valid trace
+    // (bad header, truncated, or a station whose first record is out of range)
+    bool Open(const std::string& path)
+    {
+        Close();
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || (size_t)st.st_size < HEADER_SIZE) {
+            ::close(fd);
+            return false;
+        }
+        void* base = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (base == MAP_FAILED) return false;
+        m_base = (const uint8_t*)base;
+        m_size = st.st_size;
+        // Replay walks the records in time order
+        ::madvise(base, m_size, MADV_SEQUENTIAL);
+        if (std::memcmp(m_base, "TKFT", 4) != 0 || Read16(m_base + 4) != VERSION || Read16(m_base + 6) != RECORD_SIZE) {
+            Close();
+            return false;
+        }
+        m_station_num = Read32(m_base + 8);
+        m_record_num  = Read64(m_base + 12);
+        m_epoch       = Read64(m_base + 20);
+        // Divide instead of multiply, a corrupt record num must not wrap around
+        const size_t body = m_size - HEADER_SIZE;
+        if (m_station_num > body / STATION_SIZE || m_record_num > (body - m_station_num * STATION_SIZE) / RECORD_SIZE) {
+            Close();
+            return false;
+        }
+        for (uint32_t i = 0; i < m_station_num; i++) {
+            if (Read64(StationAt(i) + STATION_ID_SIZE) >= m_record_num) {
+                Close();
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void Close()
+    {
+        if (m_base) ::munmap((void*)m_base, m_size);
+        m_base        = nullptr;
+        m_size        = 0;
+        m_station_num = 0;
+        m_record_num  = 0;
+        m_epoch       = 0;
+    }
+
+    bool IsOpen() const { return m_base != nullptr; }
+
+    // First record of a station (binary search on the station table), END if not traced
+    uint64_t Find(const std::string& station) const
+    {
+        char key[STATION_ID_SIZE] = {0};
+        std::memcpy(key, station.data(), std::min(station.size(), (size_t)STATION_ID_SIZE));
+        uint32_t lo = 0, hi = m_station_num;
+        while (lo < hi) {
+            const uint32_t mid = lo + (hi - lo) / 2;
+            const int cmp = std::memcmp(StationAt(mid), key, STATION_ID_SIZE);
+            if (cmp == 0) {
+                const uint64_t first = Read64(StationAt(mid) + STATION_ID_SIZE);
+                return first < m_record_num ? first : END;
+            }
+            if (cmp < 0) lo = mid + 1;
+            else hi = mid;
+        }
+        return END;
+    }
+
+    // index must come from Find or Next
+    Record Get(uint64_t index) const
+    {
+        const uint8_t* p = m_base + HEADER_SIZE + m_station_num * STATION_SIZE + index * RECORD_SIZE;
+        Record record;
+        record.time    = Read32(p);
+        record.next    = Read32(p + 4);
+        record.station = Read16(p + 8);
+        record.volume  = p[10];
+        return record;
+    }
+
+    // Next record of the same station, END after the last one or on a link out of range
+    uint64_t Next(uint64_t index) const
+    {
+        if (index >= m_record_num) return END;
+        const uint32_t next = Get(index).next;
+        if (next == 0 || next >= m_record_num - index) return END;
+        return index + next;
+    }
+
+    uint32_t GetStationNum() const { return m_station_num; }
+    uint64_t GetRecordNum() const { return m_record_num; }
+    uint64_t GetEpoch() const { return m_epoch; }
+
+private:
+    FillTrace(const FillTrace&);
+    FillTrace& operator=(const FillTrace&);
+
+    const uint8_t* StationAt(uint32_t index) const { return m_base + HEADER_SIZE + index * STATION_SIZE; }
+
+    static uint16_t Read16(const uint8_t* p) { return (uint16_t)(p[0] | (p[1] << 8)); }
+    static uint32_t Read32(const uint8_t* p) { return (uint32_t)Read16(p) | ((uint32_t)Read16(p + 2) << 16); }
+    static uint64_t Read64(const uint8_t* p) { return (uint64_t)Read32(p) | ((uint64_t)Read32(p + 4) << 32); }
+
+    const uint8_t* m_base;
+    size_t m_size;
+    uint32_t m_station_num;
+    uint64_t m_record_num;
+    uint64_t m_epoch;
+};
+
+} // namespace tarako
+
+#endif // TARAKO_FILL_TRACE_H
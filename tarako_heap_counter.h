@@ -0,0 +1,54 @@
+/*
+ * Counting global operator new for the scenarios.
+ *
+ * Replaces the global allocation functions with malloc/free plus a counter,
+ * so a scenario can report real heap allocations per uplink, ns-3 stack
+ * included, next to the engine's pool growth. Include it from exactly one
+ * translation unit of a program (the scenario's main file); a second
+ * definition does not link. Simulations are single-threaded, so the counter
+ * is a plain integer.
+ */
+#ifndef TARAKO_HEAP_COUNTER_H
+#define TARAKO_HEAP_COUNTER_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+namespace tarako {
+
+uint64_t heap_allocations = 0;
+
+inline uint64_t GetHeapAllocations() { return heap_allocations; }
+
+inline void* CountedAllocate(std::size_t size)
+{
+    heap_allocations++;
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+} // namespace tarako
+
+void* operator new(std::size_t size)
+{
+    void* p = tarako::CountedAllocate(size);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](std::size_t size)
+{
+    void* p = tarako::CountedAllocate(size);
+    if (p == nullptr) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return tarako::CountedAllocate(size); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return tarako::CountedAllocate(size); }
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+
+#endif // TARAKO_HEAP_COUNTER_H
@@ -0,0 +1,147 @@
+/*
+ * Interval-indexed interference tracking for a LoRa gateway.
+ *
+ * Same decision as LoraInterferenceHelper::IsDestroyedByInterference
+ * (cumulative interference energy per SF against the Goursaud isolation
+ * matrix), but events are kept in one start-time ordered ring per
+ * (channel, SF) instead of a single list. Receptions start in simulation time
+ * order, so insertion is an append, finished events are expired eagerly from
+ * the front, and an overlap query is a binary search bounded by the longest
+ * airtime in the ring: O(log n + overlaps) instead of O(all tracked events).
+ * No ns-3 dependency; times are integer nanoseconds.
+ */
+#ifndef TARAKO_INTERFERENCE_H
+#define TARAKO_INTERFERENCE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <map>
+
+namespace tarako {
+
+struct InterferenceEvent
+{
+    int64_t start;      // [ns]
+    int64_t end;        // [ns]
+    double rx_power;    // [dBm]
+    uint8_t sf;         // 7-12
+    double frequency;   // [MHz]
+    uint64_t id;
+};
+
+// SIR isolation [dB] of a signal (row) against an interferer (column), SF7..SF12
+static const double LORA_COLLISION_SNIR[6][6] =
+{
+    //  7    8    9   10   11   12
+    {   6, -16, -18, -19, -19, -20},  // SF7
+    { -24,   6, -20, -22, -22, -22},  // SF8
+    { -27, -27,   6, -23, -25, -25},  // SF9
+    { -30, -30, -30,   6, -26, -28},  // SF10
+    { -33, -33, -33, -33,   6, -29},  // SF11
+    { -36, -36, -36, -36, -36,   6}   // SF12
+};
+
+// LoRa time on air [ns], EU868 125 kHz, CR 4/5, explicit header, CRC on
+inline int64_t GetLoraOnAirTime(uint8_t sf, int payload)
+{
+    const double t_sym       = std::pow(2.0, sf) / 125000.0;
+    const bool low_dr        = sf >= 11;
+    const double preamble    = (8 + 4.25) * t_sym;
+    const double numerator   = 8.0 * payload - 4.0 * sf + 28 + 16;
+    const double denominator = 4.0 * (sf - (low_dr ? 2 : 0));
+    const double symbols     = 8 + std::max(std::ceil(numerator / denominator) * 5, 0.0);
+    return (int64_t)((preamble + symbols * t_sym) * 1e9);
+}
+
+inline double DbmToW(double dbm)
+{
+    return std::pow(10.0, dbm / 10.0) / 1000.0;
+}
+
+inline double GetOverlap(const InterferenceEvent& a, const InterferenceEvent& b)
+{
+    const int64_t s = std::max(a.start, b.start);
+    const int64_t e = std::min(a.end, b.end);
+    return e > s ? (double)(e - s) : 0.0;
+}
+
+class IntervalInterferenceTracker
+{
+public:
+    IntervalInterferenceTracker()
+        : m_max_duration(0),
+          m_size(0)
+    {
+    }
+
+    // Events must be added in non-decreasing start time
+    void Add(const InterferenceEvent& event)
+    {
+        Expire(event.start);
+        Ring& ring = m_rings[Key(event.frequency, event.sf)];
+        ring.events.push_back(event);
+        ring.max_duration = std::max(ring.max_duration, event.end - event.start);
+        m_max_duration    = std::max(m_max_duration, event.end - event.start);
+        m_size++;
+    }
+
+    bool IsDestroyedByInterference(const InterferenceEvent& event) const
+    {
+        const double signal = (double)(event.end - event.start) * DbmToW(event.rx_power);
+        for (uint8_t sf = 7; sf <= 12; sf++) {
+            auto found = m_rings.find(Key(event.frequency, sf));
+            if (found == m_rings.end()) continue;
+            const Ring& ring = found->second;
+            // Everything starting before this bound has already ended
+            const int64_t bound = event.start - ring.max_duration;
+            auto itr = std::lower_bound(ring.events.begin(), ring.events.end(), bound,
+                [](const InterferenceEvent& e, int64_t t) { return e.start < t; });
+            double interference = 0;
+            for (; itr != ring.events.end() && itr->start < event.end; ++itr) {
+                if (itr->id == event.id) continue;
+                interference += GetOverlap(event, *itr) * DbmToW(itr->rx_power);
+            }
+            if (interference <= 0) continue;
+            const double snir = 10 * std::log10(signal / interference);
+            if (snir < LORA_COLLISION_SNIR[event.sf - 7][sf - 7]) return true;
+        }
+        return false;
+    }
+
+    size_t GetSize() const { return m_size; }
+
+private:
+    struct Ring
+    {
+        Ring() : max_duration(0) {}
+        std::deque<InterferenceEvent> events;
+        int64_t max_duration;
+    };
+
+    static std::pair<int64_t, uint8_t> Key(double frequency, uint8_t sf)
+    {
+        return std::make_pair((int64_t)std::llround(frequency * 1e3), sf);
+    }
+
+    // Drop events that can no longer overlap a reception still in progress
+    void Expire(int64_t now)
+    {
+        const int64_t horizon = now - m_max_duration;
+        for (auto& ring: m_rings) {
+            while (!ring.second.events.empty() && ring.second.events.front().end < horizon) {
+                ring.second.events.pop_front();
+                m_size--;
+            }
+        }
+    }
+
+    std::map<std::pair<int64_t, uint8_t>, Ring> m_rings;
+    int64_t m_max_duration;
+    size_t m_size;
+};
+
+} // namespace tarako
+
+#endif // TARAKO_INTERFERENCE_H
@@ -0,0 +1,309 @@
+/*
+ * Node behaviour policies of the tarako scenarios.
+ *
+ * A scenario binary picks exactly one policy per axis and instantiates
+ * TarakoEngine (tarako_engine.h) with them, so the runtime callbacks never
+ * branch on the scenario mode:
+ *   - Grouping      : which nodes share a BLE group
+ *   - Pairing       : where pair groups come from (grouping.csv or none)
+ *   - Equalization  : how the group leader is chosen every interval
+ *   - Codec         : payload layout of reports
+ *   - Trigger       : when a sensor reading is reported
+ *   - Routing       : how member reports reach the leader over LrWpan
+ *   - Sensor        : where fill levels come from (synthetic or recorded trace)
+ * This header has no ns-3 dependency so the policies can be benchmarked alone.
+ */
+#ifndef TARAKO_POLICY_H
+#define TARAKO_POLICY_H
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace tarako {
+namespace policy {
+
+// --- Garbage Box Sensor --- //
+const unsigned int GARBAGE_BOX_VOLUME = 70; // UNIT: L
+
+enum GarbageBoxCondition: uint8_t
+{
+    EMPTY  = 0,
+    FILLED = 1,
+    FULL   = 2
+};
+
+template <class Volume>
+inline GarbageBoxCondition
+JudgeGarbageBoxCondition(Volume& current_volume, unsigned int inc)
+{
+    if (current_volume == 0)
+    {
+        current_volume = current_volume + inc;
+        return GarbageBoxCondition::EMPTY;
+    }
+    else if (0 < current_volume && (unsigned int)current_volume < GARBAGE_BOX_VOLUME)
+    {
+        current_volume = current_volume + inc;
+        return GarbageBoxCondition::FILLED;
+    }
+    else
+    {
+        current_volume = 0;
+        return GarbageBoxCondition::FULL;
+    }
+}
+
+// Condition of a measured fill level; emptying is part of the recorded trace
+template <class Volume>
+inline GarbageBoxCondition
+JudgeGarbageBoxLevel(const Volume& current_volume)
+{
+    if (current_volume == 0) return GarbageBoxCondition::EMPTY;
+    if ((unsigned int)current_volume < GARBAGE_BOX_VOLUME) return GarbageBoxCondition::FILLED;
+    return GarbageBoxCondition::FULL;
+}
+
+// --- Sensor Source --- //
+// 1-5 L random increment per interval (JudgeGarbageBoxCondition)
+struct RandomFill
+{
+    static const bool replays = false;
+};
+
+// Fill levels replayed from a FillTrace (tarako_fill_trace.h) at their recorded time
+struct TraceFill
+{
+    static const bool replays = true;
+};
+
+// --- Pairing Source --- //
+struct NoPairing
+{
+    static const bool enabled = false;
+    static std::vector<std::string> Load(const std::string& file, const std::string& id)
+    {
+        return std::vector<std::string>();
+    }
+};
+
+// Pair groups from grouping.csv ("GS003,GS025"), read once per file
+struct CsvPairing
+{
+    static const bool enabled = true;
+    static std::vector<std::string> Load(const std::string& file, const std::string& id)
+    {
+        static std::map<std::string, std::map<std::string, std::vector<std::string>>> cache;
+        auto found = cache.find(file);
+        if (found == cache.end()) {
+            std::map<std::string, std::vector<std::string>> pairs;
+            std::ifstream ifs(file);
+            std::string line;
+            while (std::getline(ifs, line)) {
+                std::stringstream ss(line);
+                std::string key, value;
+                if (!std::getline(ss, key, ',')) continue;
+                while (std::getline(ss, value, ',')) {
+                    if (!value.empty() && value.back() == '\r') value.pop_back();
+                    if (!value.empty()) pairs[key].push_back(value);
+                }
+            }
+            found = cache.insert(std::make_pair(file, pairs)).first;
+        }
+        auto pair = found->second.find(id);
+        if (pair == found->second.end()) return std::vector<std::string>();
+        return pair->second;
+    }
+};
+
+// --- Grouping Strategy --- //
+struct NoGrouping
+{
+    static const bool enabled = false;
+    static bool IsGroupMate(const std::string& mine, const std::string& other, const std::vector<std::string>& pairs)
+    {
+        return false;
+    }
+};
+
+// Nodes of the same garbage station, plus its pair groups (prefix match on the station id)
+struct StationGrouping
+{
+    static const bool enabled = true;
+    static bool IsGroupMate(const std::string& mine, const std::string& other, const std::vector<std::string>& pairs)
+    {
+        if (other == mine) return true;
+        for (auto& org: pairs) {
+            if (other.find(org) == 0) return true;
+        }
+        return false;
+    }
+};
+
+// --- Equalization --- //
+struct FixedLeader
+{
+    static const bool rotates = false;
+    static size_t LeaderIndex(size_t first_leader, uint32_t cycle, size_t group_size)
+    {
+        return first_leader;
+    }
+};
+
+// Leader role moves to the next group member every interval
+struct RotatingLeader
+{
+    static const bool rotates = true;
+    static size_t LeaderIndex(size_t first_leader, uint32_t cycle, size_t group_size)
+    {
+        return (first_leader + cycle) % group_size;
+    }
+};
+
+// --- Payload Codec --- //
+// One report = BLE short address (2 bytes) + condition (1 byte)
+struct ConditionCodec
+{
+    struct Entry
+    {
+        uint16_t ble_addr;
+        GarbageBoxCondition condition;
+    };
+    static const size_t ENTRY_SIZE = 3;
+    static const bool addressed    = true;  // reports name their node; needed to carry a group
+
+    static size_t Encode(const Entry* entries, size_t num, uint8_t* buffer)
+    {
+        for (size_t i = 0; i < num; i++) {
+            buffer[i * ENTRY_SIZE]     = (uint8_t)(entries[i].ble_addr >> 8);
+            buffer[i * ENTRY_SIZE + 1] = (uint8_t)(entries[i].ble_addr & 0xff);
+            buffer[i * ENTRY_SIZE + 2] = (uint8_t)entries[i].condition;
+        }
+        return num * ENTRY_SIZE;
+    }
+
+    static size_t Decode(const uint8_t* buffer, size_t size, Entry* entries, size_t max_num)
+    {
+        size_t num = 0;
+        for (; num < max_num && (num + 1) * ENTRY_SIZE <= size; num++) {
+            entries[num].ble_addr  = (uint16_t)((buffer[num * ENTRY_SIZE] << 8) | buffer[num * ENTRY_SIZE + 1]);
+            entries[num].condition = (GarbageBoxCondition)buffer[num * ENTRY_SIZE + 2];
+        }
+        return num;
+    }
+};
+
+// Payload of only_lorawan before the engine (OnlyLoRaWANPayload): the condition
+// as a 4-byte unsigned int, little endian as the x86 hosts copied it. No address,
+// so a report belongs to the LoRaWAN device that sent it.
+struct LegacyConditionCodec
+{
+    typedef ConditionCodec::Entry Entry;
+    static const size_t ENTRY_SIZE = 4;
+    static const bool addressed    = false;
+
+    static size_t Encode(const Entry* entries, size_t num, uint8_t* buffer)
+    {
+        for (size_t i = 0; i < num; i++) {
+            buffer[i * ENTRY_SIZE]     = (uint8_t)entries[i].condition;
+            buffer[i * ENTRY_SIZE + 1] = 0;
+            buffer[i * ENTRY_SIZE + 2] = 0;
+            buffer[i * ENTRY_SIZE + 3] = 0;
+        }
+        return num * ENTRY_SIZE;
+    }
+
+    static size_t Decode(const uint8_t* buffer, size_t size, Entry* entries, size_t max_num)
+    {
+        size_t num = 0;
+        for (; num < max_num && (num + 1) * ENTRY_SIZE <= size; num++) {
+            entries[num].ble_addr  = 0;
+            entries[num].condition = (GarbageBoxCondition)buffer[num * ENTRY_SIZE];
+        }
+        return num;
+    }
+};
+
+// --- Reporting Trigger --- //
+struct PeriodicTrigger
+{
+    static bool ShouldReport(GarbageBoxCondition last, GarbageBoxCondition current)
+    {
+        return true;
+    }
+};
+
+// Report only condition changes; FULL is always reported
+struct OnChangeTrigger
+{
+    static bool ShouldReport(GarbageBoxCondition last, GarbageBoxCondition current)
+    {
+        return last != current || current == GarbageBoxCondition::FULL;
+    }
+};
+
+// --- BLE Link Budget --- //
+// LrWpanPhy defaults over the LogDistancePropagationLossModel of the LrWpan channel
+struct BleLinkBudget
+{
+    static constexpr double TX_POWER_DBM      = 0.0;
+    static constexpr double RX_SENSITIVITY    = -106.58;
+    static constexpr double PATH_LOSS_EXP     = 3.0;
+    static constexpr double REFERENCE_LOSS_DB = 46.6777;
+
+    static double GetRange()
+    {
+        return std::pow(10.0, (TX_POWER_DBM - RX_SENSITIVITY - REFERENCE_LOSS_DB) / (10.0 * PATH_LOSS_EXP));
+    }
+};
+
+// --- Routing --- //
+// Member frames go straight to the leader; members out of range report over LoRaWAN
+struct DirectRoute
+{
+    static const int MAX_HOPS = 1;
+
+    static size_t EncodeHeader(uint16_t destination, uint8_t* buffer)
+    {
+        return 0;
+    }
+
+    static size_t DecodeHeader(const uint8_t* buffer, size_t size, uint16_t self, uint16_t* destination)
+    {
+        *destination = self;
+        return 0;
+    }
+};
+
+// Frames carry the final destination (2 bytes) and are forwarded hop by hop
+struct MultiHopRoute
+{
+    static const int MAX_HOPS = 4;
+
+    static size_t EncodeHeader(uint16_t destination, uint8_t* buffer)
+    {
+        buffer[0] = (uint8_t)(destination >> 8);
+        buffer[1] = (uint8_t)(destination & 0xff);
+        return 2;
+    }
+
+    static size_t DecodeHeader(const uint8_t* buffer, size_t size, uint16_t self, uint16_t* destination)
+    {
+        if (size < 2) {
+            *destination = self;
+            return size;
+        }
+        *destination = (uint16_t)((buffer[0] << 8) | buffer[1]);
+        return 2;
+    }
+};
+
+} // namespace policy
+} // namespace tarako
+
+#endif // TARAKO_POLICY_H